@@ -0,0 +1,111 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#include "../Sources/Binauralizer.hpp"
+#include "../Sources/ThreadPool.hpp"
+
+using namespace hoa;
+using namespace hrir_matrix_creator;
+
+static void printUsage()
+{
+    std::cout << "usage : HrirBinauralizer [-j jobs] [-b block_size] [-o output_folder] subject files...\n"
+    << "    subject : a generated header (.hpp) or a compressed file\n"
+    << "    files : the ambisonic wav files to render\n";
+}
+
+static std::string getOutputPath(std::string const& folder, std::string const& input)
+{
+    auto name = input;
+    auto pos = name.find_last_of('/');
+    if(pos != std::string::npos)
+    {
+        name.erase(0, pos + 1);
+    }
+    
+    pos = name.find_last_of('.');
+    if(pos != std::string::npos)
+    {
+        name.erase(pos);
+    }
+    
+    return folder + "/" + name + "_binaural.wav";
+}
+
+int main(int argc, const char * argv[])
+{
+    size_t jobs = ThreadPool::getHardwareConcurrency();
+    size_t block_size = 4096;
+    std::string output_folder = ".";
+    std::vector<std::string> arguments;
+    
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if((argument == "-j" || argument == "-b" || argument == "-o") && i + 1 < argc)
+        {
+            const std::string value = argv[++i];
+            if(argument == "-j") { jobs = size_t(std::max(std::atol(value.c_str()), 1l)); }
+            else if(argument == "-b") { block_size = size_t(std::max(std::atol(value.c_str()), 1l)); }
+            else { output_folder = value; }
+        }
+        else
+        {
+            arguments.emplace_back(argument);
+        }
+    }
+    
+    if(arguments.size() < 2)
+    {
+        printUsage();
+        return 1;
+    }
+    
+    HrirMatrices matrices;
+    if(!matrices.load(arguments[0]))
+    {
+        std::cerr << "[!] error - can't load subject " << arguments[0] << "\n";
+        return 1;
+    }
+    
+    const Binauralizer binauralizer(matrices, block_size);
+    std::cout << "subject : " << arguments[0] << " (order " << matrices.order
+    << ", " << matrices.number_of_harmonics << " harmonics)\n";
+    
+    std::mutex output_mutex;
+    std::atomic<size_t> errors {0};
+    
+    {
+        ThreadPool pool(std::min(jobs, arguments.size() - 1));
+        for(size_t i = 1; i < arguments.size(); i++)
+        {
+            const auto input = arguments[i];
+            pool.push([&, input]() {
+                
+                const auto report = binauralizer.render(input, getOutputPath(output_folder, input));
+                
+                std::lock_guard<std::mutex> lock(output_mutex);
+                if(report.valid)
+                {
+                    std::cout << input << " : " << report.duration << "s rendered in "
+                    << report.elapsed << "s (realtime factor " << report.getRealtimeFactor() << ")\n";
+                }
+                else
+                {
+                    ++errors;
+                    std::cerr << "[!] error - " << report.error << "\n";
+                }
+            });
+        }
+        
+        pool.wait();
+    }
+    
+    return errors ? 1 : 0;
+}
@@ -8,6 +8,7 @@
 // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
 
 #include "../Sources/HrirCreator.hpp"
+#include "../Sources/Rotation.hpp"
 
 using namespace hoa;
 using namespace hrir_matrix_creator;
@@ -18,6 +19,46 @@ int main(int argc, const char * argv[])
     
     using namespace std::string_literals;
     
+    for(int i = 1; i < argc; i++)
+    {
+        if(argv[i] == "--benchmark-rotation"s)
+        {
+            benchmarkRotation<Hoa2d>(std::cout);
+            benchmarkRotation<Hoa3d>(std::cout);
+            return 0;
+        }
+        
+        if(argv[i] == "--check-harmonics"s)
+        {
+            const bool valid_2d = checkHarmonics<Hoa2d>(std::cout);
+            const bool valid_3d = checkHarmonics<Hoa3d>(std::cout);
+            return (valid_2d && valid_3d) ? 0 : 1;
+        }
+        
+        if(argv[i] == "--check-accumulation"s)
+        {
+            const bool valid_2d = checkAccumulation<Hoa2d>(std::cout, 5);
+            const bool valid_3d = checkAccumulation<Hoa3d>(std::cout, 3);
+            return (valid_2d && valid_3d) ? 0 : 1;
+        }
+        
+        if(argv[i] == "--check-kernels"s)
+        {
+            return Dispatch::checkKernels(std::cout) ? 0 : 1;
+        }
+        
+        if(std::string(argv[i]).rfind("--isa=", 0) == 0)
+        {
+            if(!Dispatch::setIsa(std::string(argv[i]).substr(6)))
+            {
+                std::cerr << "[!] error - unknown instruction set " << argv[i] << " (generic, avx2 or avx512)\n";
+                return 1;
+            }
+        }
+    }
+    
+    std::cout << "Instruction set : " << Dispatch::getName(Dispatch::getIsa()) << "\n";
+    
     const auto database_path = "../ThirdParty/HrirDatabase"s;
     const auto Sadie_database_path = database_path + "/Sadie";
     const auto Listen_database_path = database_path + "/Listen";
@@ -132,10 +173,7 @@ int main(int argc, const char * argv[])
         }
     }
     
-    for(auto& config : configs)
-    {
-        writeCppFileForConfig(config);
-    }
+    writeCppFilesForConfigs(configs);
 
     return 0;
 }
@@ -0,0 +1,419 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#include "HrirMatrixLibrary.hpp"
+#include "../Sources/Subject.hpp"
+
+#include <cstdint>
+#include <new>
+#include <set>
+
+namespace hoa::hrir_matrix_creator
+{
+    struct HrirMatrixGenerator::Implementation
+    {
+        Config                  config {};
+        std::vector<Response>   responses {};
+        std::set<double>        radii {};
+        size_t                  size = 0;
+
+        void add(Response&& response)
+        {
+            size = std::max(size, response.getNumberOfSamplesPerChannel());
+            radii.insert(response.getRadius());
+            responses.emplace_back(std::move(response));
+        }
+
+        size_t getOrder() const noexcept
+        {
+            return config.orders.empty() ? config.order : *config.orders.rbegin();
+        }
+
+        size_t getNumberOfHarmonics(size_t order) const noexcept
+        {
+            return (config.dimension == Hoa2d) ? (order * 2 + 1) : ((order + 1) * (order + 1));
+        }
+
+        size_t getNumberOfDistances() const noexcept
+        {
+            return config.split_by_radius ? std::max(radii.size(), size_t(1)) : 1;
+        }
+
+        //! @brief Returns the samplerate shared by all the responses, 0 if they don't share one.
+        double getSamplerate() const noexcept
+        {
+            const double samplerate = responses.empty() ? 0. : responses.front().getSamplerate();
+            for(auto const& response : responses)
+            {
+                if(response.getSamplerate() != samplerate)
+                {
+                    return 0.;
+                }
+            }
+            return samplerate;
+        }
+
+        //! @brief Projects the responses with the settings of the config and passes the subject to a callback.
+        //! @details The responses are borrowed by the subject, the matrices are only factorized
+        //! if the low rank matrices are required.
+        template<Dimension Dim, class Callback>
+        void visit(bool compressed, Callback&& callback) const
+        {
+            Config subject_config = config;
+            subject_config.order = getOrder();
+            subject_config.low_rank_energy = compressed ? config.low_rank_energy : 0.;
+            subject_config.verbose = false;
+
+            Subject<Dim> subject(subject_config);
+            subject.read(responses);
+            callback(subject);
+        }
+
+        template<class Callback>
+        void visit(bool compressed, Callback&& callback) const
+        {
+            switch(config.dimension)
+            {
+                case hoa::Hoa2d : { visit<Hoa2d>(compressed, callback); break;}
+                case hoa::Hoa3d : { visit<Hoa3d>(compressed, callback); break;}
+            }
+        }
+    };
+
+    HrirMatrixGenerator::HrirMatrixGenerator(Dimension dimension, size_t order)
+    : m_implementation(std::make_unique<Implementation>())
+    {
+        m_implementation->config.dimension = dimension;
+        m_implementation->config.order = order;
+    }
+
+    HrirMatrixGenerator::HrirMatrixGenerator(Config const& config)
+    : m_implementation(std::make_unique<Implementation>())
+    {
+        m_implementation->config = config;
+    }
+
+    HrirMatrixGenerator::HrirMatrixGenerator(HrirMatrixGenerator&& other) noexcept = default;
+    HrirMatrixGenerator& HrirMatrixGenerator::operator=(HrirMatrixGenerator&& other) noexcept = default;
+    HrirMatrixGenerator::~HrirMatrixGenerator() = default;
+
+    Status HrirMatrixGenerator::addResponse(ImpulseResponse const& response) noexcept
+    {
+        if(!response.left || !response.right || !response.size)
+        {
+            return Status::InvalidArguments;
+        }
+
+        if(m_implementation->config.dimension == Hoa2d && response.elevation != 0.)
+        {
+            return Status::OutOfPlane;
+        }
+
+        try
+        {
+            std::vector<double> values (response.size * 2);
+            for(size_t j = 0; j < response.size; j++)
+            {
+                values[j * 2] = response.left[j];
+                values[j * 2 + 1] = response.right[j];
+            }
+
+            m_implementation->add(Response(response.azimuth, response.elevation, response.radius,
+                                             std::move(values), response.samplerate));
+        }
+        catch(std::bad_alloc&)
+        {
+            return Status::OutOfMemory;
+        }
+
+        return Status::Success;
+    }
+
+    Status HrirMatrixGenerator::addResponses(Config const& config) noexcept
+    {
+        try
+        {
+            const auto& files = config.wave_files;
+            const bool files_specified = !files.empty();
+            size_t found = 0;
+
+            for(auto const& file : config.wave_folder.getFiles(".wav"))
+            {
+                if(files_specified && (files.find(file.getName()) == files.end()))
+                {
+                    continue;
+                }
+
+                Response response(file, config.database_type);
+                if(!response.isValid()
+                   || (m_implementation->config.dimension == Hoa2d && response.getElevation() != 0.))
+                {
+                    continue;
+                }
+
+                if(!response.load())
+                {
+                    return Status::ReadError;
+                }
+
+                m_implementation->add(std::move(response));
+                ++found;
+            }
+
+            if(files_specified && found != files.size())
+            {
+                return Status::ReadError;
+            }
+        }
+        catch(std::bad_alloc&)
+        {
+            return Status::OutOfMemory;
+        }
+
+        return Status::Success;
+    }
+
+    size_t HrirMatrixGenerator::getNumberOfResponses() const noexcept
+    {
+        return m_implementation->responses.size();
+    }
+
+    size_t HrirMatrixGenerator::getResponsesSize() const noexcept
+    {
+        return m_implementation->size;
+    }
+
+    size_t HrirMatrixGenerator::getDecompositionOrder() const noexcept
+    {
+        return m_implementation->getOrder();
+    }
+
+    size_t HrirMatrixGenerator::getNumberOfHarmonics() const noexcept
+    {
+        return m_implementation->getNumberOfHarmonics(m_implementation->getOrder());
+    }
+
+    size_t HrirMatrixGenerator::getNumberOfDistances() const noexcept
+    {
+        return m_implementation->getNumberOfDistances();
+    }
+
+    size_t HrirMatrixGenerator::getMatrixSize() const noexcept
+    {
+        return getMatrixSize(getDecompositionOrder());
+    }
+
+    size_t HrirMatrixGenerator::getMatrixSize(size_t order) const noexcept
+    {
+        return getResponsesSize() * m_implementation->getNumberOfHarmonics(order) * getNumberOfDistances();
+    }
+
+    //! @brief Checks the storage of the caller.
+    static Status checkStorage(double const* left, double const* right) noexcept
+    {
+        if(!left || !right)
+        {
+            return Status::InvalidArguments;
+        }
+
+        if(reinterpret_cast<uintptr_t>(left) % HrirMatrixGenerator::storage_alignment
+           || reinterpret_cast<uintptr_t>(right) % HrirMatrixGenerator::storage_alignment)
+        {
+            return Status::UnalignedStorage;
+        }
+
+        return Status::Success;
+    }
+
+    Status HrirMatrixGenerator::process(double* left, double* right, size_t capacity) const noexcept
+    {
+        return process(getDecompositionOrder(), left, right, capacity);
+    }
+
+    Status HrirMatrixGenerator::process(size_t order, double* left, double* right, size_t capacity) const noexcept
+    {
+        const auto status = checkStorage(left, right);
+        if(status != Status::Success)
+        {
+            return status;
+        }
+
+        if(order > getDecompositionOrder())
+        {
+            return Status::InvalidOrder;
+        }
+
+        if(m_implementation->responses.empty())
+        {
+            return Status::NoResponses;
+        }
+
+        if(capacity < getMatrixSize(order))
+        {
+            return Status::InsufficientStorage;
+        }
+
+        try
+        {
+            m_implementation->visit(false, [&](auto const& subject) {
+
+                auto copy = [left, right](auto const& matrices) {
+                    auto const& left_matrix = matrices.getLeftMatrix();
+                    auto const& right_matrix = matrices.getRightMatrix();
+                    std::copy(left_matrix.begin(), left_matrix.end(), left);
+                    std::copy(right_matrix.begin(), right_matrix.end(), right);
+                };
+
+                if(order == subject.getDecompositionOrder())
+                {
+                    copy(subject);
+                    return;
+                }
+
+                // the responses are only needed by the analysis of the sliced matrices.
+                Config order_config = m_implementation->config;
+                order_config.order = order;
+                order_config.low_rank_energy = 0.;
+                order_config.write_analysis = false;
+                order_config.verbose = false;
+                copy(subject.withOrder(order_config));
+            });
+        }
+        catch(std::bad_alloc&)
+        {
+            return Status::OutOfMemory;
+        }
+
+        return Status::Success;
+    }
+
+    Status HrirMatrixGenerator::process(LowRankMatrices& matrices) const noexcept
+    {
+        if(!(m_implementation->config.low_rank_energy > 0.))
+        {
+            return Status::InvalidArguments;
+        }
+
+        if(m_implementation->responses.empty())
+        {
+            return Status::NoResponses;
+        }
+
+        try
+        {
+            m_implementation->visit(true, [&matrices](auto const& subject) {
+
+                auto const& left = subject.getLeftLowRank();
+                auto const& right = subject.getRightLowRank();
+                matrices.left_rank = left.getRank();
+                matrices.right_rank = right.getRank();
+                matrices.left_basis = left.getBasis();
+                matrices.left_mixing = left.getMixing();
+                matrices.right_basis = right.getBasis();
+                matrices.right_mixing = right.getMixing();
+            });
+        }
+        catch(std::bad_alloc&)
+        {
+            return Status::OutOfMemory;
+        }
+
+        return Status::Success;
+    }
+
+    size_t HrirMatrixGenerator::getNearFieldFiltersSize() const noexcept
+    {
+        if(!m_implementation->config.split_by_radius)
+        {
+            return 0;
+        }
+
+        // one filter per degree and per distance
+        const auto order = getDecompositionOrder();
+        const auto sections = std::max(NearField::getNumberOfSections(order), size_t(1));
+        return getNumberOfDistances() * (order + 1) * sections * 5;
+    }
+
+    Status HrirMatrixGenerator::getNearFieldFilters(double* filters, size_t capacity) const noexcept
+    {
+        if(!filters || !m_implementation->config.split_by_radius)
+        {
+            return Status::InvalidArguments;
+        }
+
+        if(m_implementation->responses.empty())
+        {
+            return Status::NoResponses;
+        }
+
+        if(!(m_implementation->getSamplerate() > 0.))
+        {
+            return Status::InvalidSamplerate;
+        }
+
+        if(capacity < getNearFieldFiltersSize())
+        {
+            return Status::InsufficientStorage;
+        }
+
+        try
+        {
+            // the filters only depend on the distances and the samplerate, nothing is projected.
+            Config subject_config = m_implementation->config;
+            subject_config.order = getDecompositionOrder();
+            subject_config.verbose = false;
+
+            auto copy = [&](auto&& subject) {
+                subject.setResponses(m_implementation->responses);
+                const auto values = subject.getNearFieldFilters();
+                std::copy(values.begin(), values.end(), filters);
+            };
+
+            switch(subject_config.dimension)
+            {
+                case hoa::Hoa2d : { copy(Subject<Hoa2d>(subject_config)); break;}
+                case hoa::Hoa3d : { copy(Subject<Hoa3d>(subject_config)); break;}
+            }
+        }
+        catch(std::bad_alloc&)
+        {
+            return Status::OutOfMemory;
+        }
+
+        return Status::Success;
+    }
+
+    Status HrirMatrixGenerator::writeAnalysis(std::ostream& stream) const noexcept
+    {
+        if(m_implementation->responses.empty())
+        {
+            return Status::NoResponses;
+        }
+
+        if(!(m_implementation->getSamplerate() > 0.))
+        {
+            return Status::InvalidSamplerate;
+        }
+
+        try
+        {
+            const auto number_of_threads = m_implementation->config.number_of_threads;
+            ThreadPool pool(number_of_threads ? number_of_threads : ThreadPool::getHardwareConcurrency());
+            m_implementation->visit(false, [&stream, &pool](auto const& subject) {
+                subject.writeAnalysis(stream, pool);
+            });
+        }
+        catch(std::bad_alloc&)
+        {
+            return Status::OutOfMemory;
+        }
+
+        return Status::Success;
+    }
+}
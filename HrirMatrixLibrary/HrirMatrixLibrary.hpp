@@ -0,0 +1,160 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include "../Sources/Config.hpp"
+
+#include <memory>
+#include <vector>
+#include <ostream>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // HrirMatrixGenerator
+    // ================================================================================ //
+
+    //! @brief The status returned by the generator.
+    enum class Status
+    {
+        Success = 0,
+        InvalidArguments,       //! a null pointer, an empty response or a setting disabled in the config
+        OutOfPlane,             //! a 2D generator only accepts the responses of the horizontal plane
+        InvalidOrder,           //! the order is higher than the order of the generator
+        InvalidSamplerate,      //! the responses don't share a positive samplerate
+        UnalignedStorage,       //! the storage isn't aligned on storage_alignment bytes
+        InsufficientStorage,    //! the capacity is lower than getMatrixSize()
+        NoResponses,            //! no response has been added
+        ReadError,              //! a wav file of the config can't be read
+        OutOfMemory
+    };
+
+    //! @brief A binaural impulse response in memory.
+    //! @details The azimuth and the elevation are in radians, the elevation must be 0 in 2D.
+    //! The radius is only used if the config splits the responses by radius, the samplerate
+    //! by the near field filters and the analysis.
+    struct ImpulseResponse
+    {
+        double          azimuth = 0.;
+        double          elevation = 0.;
+        double          radius = 1.;        //! meters
+        double          samplerate = 0.;    //! Hz
+        double const*   left = nullptr;
+        double const*   right = nullptr;
+        size_t          size = 0;
+    };
+
+    //! @brief The low rank factorizations of the left and the right matrices.
+    //! @details The basis filters are (responses size x number of distances) x rank, sample
+    //! major, and the mixing matrices are number of harmonics x rank, harmonic major.
+    struct LowRankMatrices
+    {
+        size_t              left_rank = 0;
+        size_t              right_rank = 0;
+        std::vector<double> left_basis {};
+        std::vector<double> left_mixing {};
+        std::vector<double> right_basis {};
+        std::vector<double> right_mixing {};
+    };
+
+    //! @brief The generator creates the HRIR matrices in memory, without writing files.
+    //! @details The matrices are stored sample major (responses size x number of harmonics)
+    //! like the generated tables and are identical to them. All the settings of the config
+    //! are applied : accumulation, symmetry, low rank factorization, orders and distances.
+    //! If the responses are split by radius, the matrices of the distances are contiguous.
+    //!
+    //! Allocations : addResponse() and addResponses() copy the samples in the generator,
+    //! the processing methods borrow them, allocate their working buffers and free them
+    //! before returning. The
+    //! matrices are only written in the storage of the caller, which must be aligned on
+    //! storage_alignment bytes and hold getMatrixSize() values, and is never retained.
+    //!
+    //! Threads : the generator never prints and only reads the files of a config.
+    //! Several generators can be used concurrently and process() can be called
+    //! concurrently on the same generator, but not while responses are added.
+    //!
+    //! None of the methods throws, the errors are returned as a status.
+    class HrirMatrixGenerator
+    {
+    public:
+
+        static constexpr size_t storage_alignment = 64;
+
+        HrirMatrixGenerator(Dimension dimension, size_t order);
+
+        //! @brief Creates a generator with all the settings of a config.
+        //! @details The order of the generator is the highest of the orders of the config if set.
+        explicit HrirMatrixGenerator(Config const& config);
+
+        HrirMatrixGenerator(HrirMatrixGenerator&& other) noexcept;
+        HrirMatrixGenerator& operator=(HrirMatrixGenerator&& other) noexcept;
+        ~HrirMatrixGenerator();
+
+        //! @brief Copies a response in the generator.
+        //! @details A 2D generator refuses the responses out of the horizontal plane.
+        Status addResponse(ImpulseResponse const& response) noexcept;
+
+        //! @brief Reads the wav files of the folder of a config.
+        //! @details The files are filtered like the command line tool, with the wave files
+        //! and the database type of the config. Nothing is printed.
+        Status addResponses(Config const& config) noexcept;
+
+        //! @brief Returns the number of responses added.
+        size_t getNumberOfResponses() const noexcept;
+
+        //! @brief Returns the size of the longest response.
+        size_t getResponsesSize() const noexcept;
+
+        //! @brief Returns the order of the generator.
+        size_t getDecompositionOrder() const noexcept;
+
+        size_t getNumberOfHarmonics() const noexcept;
+
+        //! @brief Returns the number of matrices, one per distance if the responses are split by radius.
+        size_t getNumberOfDistances() const noexcept;
+
+        //! @brief Returns the number of values of each matrix, all the distances included.
+        size_t getMatrixSize() const noexcept;
+
+        //! @brief Returns the number of values of each matrix of a lower order.
+        size_t getMatrixSize(size_t order) const noexcept;
+
+        //! @brief Projects the responses and writes the matrices in the storage of the caller.
+        //! @param left The left matrix storage.
+        //! @param right The right matrix storage.
+        //! @param capacity The number of values of each storage.
+        Status process(double* left, double* right, size_t capacity) const noexcept;
+
+        //! @brief Projects the responses and writes the matrices of a lower order.
+        //! @details The matrices are sliced from the projection at the order of the generator,
+        //! like the files written for the orders of a config.
+        Status process(size_t order, double* left, double* right, size_t capacity) const noexcept;
+
+        //! @brief Projects the responses and factorizes the matrices, low_rank_energy must be set.
+        Status process(LowRankMatrices& matrices) const noexcept;
+
+        //! @brief Returns the number of values of the near field filters, 0 if not split by radius.
+        size_t getNearFieldFiltersSize() const noexcept;
+
+        //! @brief Writes the near field compensation filters in the storage of the caller.
+        //! @details The filters are stored [distance][degree][section][b0, b1, b2, a1, a2] like the
+        //! generated tables. The responses must be split by radius and share a samplerate.
+        Status getNearFieldFilters(double* filters, size_t capacity) const noexcept;
+
+        //! @brief Projects the responses and writes the reconstruction error report in a stream.
+        //! @details The responses must share a samplerate.
+        Status writeAnalysis(std::ostream& stream) const noexcept;
+
+    private:
+
+        struct Implementation;
+        std::unique_ptr<Implementation> m_implementation;
+    };
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include "Dispatch.hpp"
+
+#include <vector>
+#include <algorithm>
+
+namespace hoa::hrir_matrix_creator
+{
+    enum class Accumulation
+    {
+        Double = 0,
+        CompensatedFloat
+    };
+
+    // ================================================================================ //
+    // CompensatedAccumulator
+    // ================================================================================ //
+
+    //! @brief The compensated accumulator sums vectors in single precision with a Kahan compensation.
+    //! @details The sums and the compensations are stored in two contiguous float
+    //! arrays so the inner loop has no dependency between the lanes and is
+    //! vectorized with twice the width of the double accumulation. The compensation
+    //! relies on strict floating-point semantics, it must not be compiled with -ffast-math.
+    class CompensatedAccumulator
+    {
+    public:
+
+        CompensatedAccumulator(size_t size)
+        : m_sums(size, 0.f)
+        , m_compensations(size, 0.f)
+        {}
+
+        ~CompensatedAccumulator() = default;
+
+        //! @brief Adds gain * values to the sums starting at the offset.
+        //! @details The loop is the dispatched kernel of the instruction set of the CPU.
+        void add(size_t offset, size_t size, float gain, float const* values) noexcept
+        {
+            Dispatch::getKernels().accumulateCompensated(m_sums.data() + offset, m_compensations.data() + offset,
+                                                         values, gain, size);
+        }
+
+        //! @brief Writes the compensated sums in a double precision vector.
+        void get(std::vector<double>& output) const
+        {
+            output.resize(m_sums.size());
+            for(size_t i = 0; i < m_sums.size(); i++)
+            {
+                output[i] = double(m_sums[i]) - double(m_compensations[i]);
+            }
+        }
+
+    private:
+
+        std::vector<float> m_sums {};
+        std::vector<float> m_compensations {};
+    };
+}
@@ -0,0 +1,231 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include "Fft.hpp"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <ostream>
+#include <string>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // Analysis
+    // ================================================================================ //
+
+    //! @brief The analysis compares a reconstructed binaural response with the measured one.
+    //! @details The spectral error is the mean absolute difference of the magnitudes in dB,
+    //! globally and per octave band. The ILD error is the difference of the broadband
+    //! level differences between the ears. The ITD error is the difference of the lags
+    //! of the maximum of the interaural cross-correlation.
+    //! An analysis is read-only once created, it can be shared by several threads.
+    class Analysis
+    {
+    public:
+
+        using complex_t = std::complex<double>;
+
+        struct Error
+        {
+            double              azimuth = 0.;
+            double              elevation = 0.;
+            double              spectral = 0.;  //! dB
+            double              ild = 0.;       //! dB
+            double              itd = 0.;       //! us
+            std::vector<double> bands {};       //! dB
+        };
+
+        Analysis(size_t responses_size, double samplerate)
+        : m_size(responses_size)
+        , m_samplerate(samplerate > 0. ? samplerate : 44100.)
+        , m_fft(Fft<double>::getPowerOfTwo(std::max(2 * responses_size, size_t(2))))
+        {
+            // octave bands from 125Hz up to the Nyquist frequency, the bands
+            // without any bin of the FFT are omitted (short responses).
+            const double resolution = m_samplerate / double(m_fft.getSize());
+            for(double center = 125.; center * std::sqrt(2.) <= m_samplerate / 2.; center *= 2.)
+            {
+                const double first_bin = std::max(std::ceil(center / std::sqrt(2.) / resolution), 1.);
+                if(first_bin * resolution < center * std::sqrt(2.))
+                {
+                    m_bands.push_back(center);
+                }
+            }
+        }
+
+        ~Analysis() = default;
+
+        inline std::vector<double> const& getBands() const noexcept
+        {
+            return m_bands;
+        }
+
+        //! @brief Compares the measured and reconstructed responses (responses size samples each).
+        Error compare(double const* measured_left, double const* measured_right,
+                      double const* reconstructed_left, double const* reconstructed_right) const
+        {
+            Error error;
+            const auto fft_size = m_fft.getSize();
+            std::vector<complex_t> measured (fft_size), reconstructed (fft_size);
+
+            // the left ear is packed in the real part and the right ear in the imaginary part.
+            for(size_t j = 0; j < m_size; j++)
+            {
+                measured[j] = complex_t(measured_left[j], measured_right[j]);
+                reconstructed[j] = complex_t(reconstructed_left[j], reconstructed_right[j]);
+            }
+
+            m_fft.forward(measured.data());
+            m_fft.forward(reconstructed.data());
+
+            const size_t bins = fft_size / 2;
+            std::vector<double> band_sums (m_bands.size(), 0.);
+            std::vector<size_t> band_counts (m_bands.size(), 0);
+            double spectral_sum = 0.;
+            size_t spectral_count = 0;
+            double measured_energy[2] = {0., 0.};
+            double reconstructed_energy[2] = {0., 0.};
+
+            std::vector<complex_t> measured_correlation (fft_size), reconstructed_correlation (fft_size);
+
+            for(size_t f = 0; f < fft_size; f++)
+            {
+                complex_t ml, mr, rl, rr;
+                split(measured.data(), f, ml, mr);
+                split(reconstructed.data(), f, rl, rr);
+
+                measured_correlation[f] = ml * std::conj(mr);
+                reconstructed_correlation[f] = rl * std::conj(rr);
+
+                if(f == 0 || f > bins)
+                {
+                    continue;
+                }
+
+                measured_energy[0] += std::norm(ml);
+                measured_energy[1] += std::norm(mr);
+                reconstructed_energy[0] += std::norm(rl);
+                reconstructed_energy[1] += std::norm(rr);
+
+                const double difference = 0.5 * (std::abs(getDecibels(std::norm(rl)) - getDecibels(std::norm(ml)))
+                                                  + std::abs(getDecibels(std::norm(rr)) - getDecibels(std::norm(mr))));
+                spectral_sum += difference;
+                ++spectral_count;
+
+                const double frequency = double(f) * m_samplerate / double(fft_size);
+                for(size_t b = 0; b < m_bands.size(); b++)
+                {
+                    if(frequency >= m_bands[b] / std::sqrt(2.) && frequency < m_bands[b] * std::sqrt(2.))
+                    {
+                        band_sums[b] += difference;
+                        ++band_counts[b];
+                    }
+                }
+            }
+
+            error.spectral = spectral_count ? spectral_sum / double(spectral_count) : 0.;
+            error.bands.resize(m_bands.size());
+            for(size_t b = 0; b < m_bands.size(); b++)
+            {
+                error.bands[b] = band_counts[b] ? band_sums[b] / double(band_counts[b]) : 0.;
+            }
+
+            const double measured_ild = getDecibels(measured_energy[0]) - getDecibels(measured_energy[1]);
+            const double reconstructed_ild = getDecibels(reconstructed_energy[0]) - getDecibels(reconstructed_energy[1]);
+            error.ild = std::abs(measured_ild - reconstructed_ild);
+
+            const double measured_itd = getLag(measured_correlation);
+            const double reconstructed_itd = getLag(reconstructed_correlation);
+            error.itd = std::abs(measured_itd - reconstructed_itd) / m_samplerate * 1e6;
+
+            return error;
+        }
+
+        //! @brief Writes the report of the errors of all the directions.
+        void writeReport(std::ostream& stream, std::string const& name, std::vector<Error> const& errors) const
+        {
+            auto writeSummary = [&](std::string const& label, auto getter) {
+                double sum = 0., maximum = 0.;
+                for(auto const& error : errors)
+                {
+                    sum += getter(error);
+                    maximum = std::max(maximum, getter(error));
+                }
+                stream << label << " mean " << (errors.empty() ? 0. : sum / double(errors.size())) << " max " << maximum << "\n";
+            };
+
+            stream << "# " << name << " : " << errors.size() << " directions, samplerate " << m_samplerate << "\n";
+            writeSummary("spectral_error_db", [](Error const& e) { return e.spectral; });
+            writeSummary("ild_error_db", [](Error const& e) { return e.ild; });
+            writeSummary("itd_error_us", [](Error const& e) { return e.itd; });
+
+            stream << "# band center (Hz) : mean spectral error (dB)\n";
+            for(size_t b = 0; b < m_bands.size(); b++)
+            {
+                double sum = 0.;
+                for(auto const& error : errors)
+                {
+                    sum += error.bands[b];
+                }
+                stream << m_bands[b] << " " << (errors.empty() ? 0. : sum / double(errors.size())) << "\n";
+            }
+
+            stream << "# azimuth elevation (degrees) spectral (dB) ild (dB) itd (us)\n";
+            for(auto const& error : errors)
+            {
+                stream << error.azimuth << " " << error.elevation << " "
+                << error.spectral << " " << error.ild << " " << error.itd << "\n";
+            }
+        }
+
+    private:
+
+        static inline double getDecibels(double energy) noexcept
+        {
+            return 10. * std::log10(std::max(energy, 1e-20));
+        }
+
+        //! @brief Separates the spectra of the real and imaginary parts of a packed spectrum.
+        inline void split(complex_t const* spectrum, size_t f, complex_t& real, complex_t& imaginary) const noexcept
+        {
+            const auto fft_size = m_fft.getSize();
+            const complex_t z = spectrum[f];
+            const complex_t zc = std::conj(spectrum[(fft_size - f) & (fft_size - 1)]);
+            real = (z + zc) * 0.5;
+            imaginary = (z - zc) * complex_t(0., -0.5);
+        }
+
+        //! @brief Returns the lag in samples of the maximum of a cross-correlation spectrum.
+        double getLag(std::vector<complex_t> correlation) const noexcept
+        {
+            m_fft.inverse(correlation.data());
+            const auto fft_size = m_fft.getSize();
+
+            size_t best = 0;
+            for(size_t i = 1; i < fft_size; i++)
+            {
+                if(std::abs(correlation[i].real()) > std::abs(correlation[best].real()))
+                {
+                    best = i;
+                }
+            }
+
+            return (best > fft_size / 2) ? double(best) - double(fft_size) : double(best);
+        }
+
+        const size_t        m_size;
+        const double        m_samplerate;
+        const Fft<double>   m_fft;
+        std::vector<double> m_bands {};
+    };
+}
@@ -0,0 +1,391 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include "../ThirdParty/LibSndFile/src/sndfile.hh"
+
+#include "Config.hpp"
+#include "Codec.hpp"
+#include "Fft.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // HrirMatrices
+    // ================================================================================ //
+
+    //! @brief The HRIR matrices loaded from a generated subject.
+    //! @details The matrices are stored sample major (responses size x number of harmonics)
+    //! like the generated tables.
+    struct HrirMatrices
+    {
+        Dimension           dimension = Dimension::Hoa2d;
+        size_t              order = 0;
+        size_t              number_of_harmonics = 0;
+        size_t              responses_size = 0;
+        std::vector<double> left {};
+        std::vector<double> right {};
+
+        //! @brief Loads a compressed binary file or a generated header (.hpp).
+        bool load(std::string const& path)
+        {
+            const auto pos = path.find_last_of('.');
+            if(pos != std::string::npos && path.substr(pos) == ".hpp")
+            {
+                return loadHeader(path);
+            }
+
+            return loadCompressed(path);
+        }
+
+        bool loadCompressed(std::string const& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            codec::CompressedMatrices matrices;
+            if(!file.is_open() || !matrices.read(file)
+               || matrices.getNumberOfTables() < (matrices.isSymmetric() ? 1 : 2))
+            {
+                return false;
+            }
+
+            dimension = (matrices.dimension == 3) ? Dimension::Hoa3d : Dimension::Hoa2d;
+            order = matrices.order;
+            number_of_harmonics = matrices.number_of_harmonics;
+            responses_size = matrices.responses_size;
+            matrices.decodeTable(0, left);
+            if(!matrices.isSymmetric())
+            {
+                matrices.decodeTable(1, right);
+                return true;
+            }
+
+            // the right ear is the left ear multiplied by the sign mask
+            right.resize(left.size());
+            for(size_t i = 0; i < left.size(); i++)
+            {
+                right[i] = matrices.right_sign_mask[i % number_of_harmonics] * left[i];
+            }
+            return true;
+        }
+
+        bool loadHeader(std::string const& path)
+        {
+            std::ifstream file(path);
+            if(!file.is_open())
+            {
+                return false;
+            }
+
+            std::stringstream ss;
+            ss << file.rdbuf();
+            const std::string text = expandIncludes(ss.str(), path.substr(0, path.find_last_of('/') + 1));
+
+            dimension = (text.find("Dimension::Hoa3d") != std::string::npos) ? Dimension::Hoa3d : Dimension::Hoa2d;
+
+            if(!(readConstant(text, "order", order)
+                 && readConstant(text, "number_of_harmonics", number_of_harmonics)
+                 && readConstant(text, "responses_size", responses_size)
+                 && readTable(text, "get_double_left()", number_of_harmonics * responses_size, left)))
+            {
+                return false;
+            }
+
+            if(text.find("static const bool symmetric = true;") == std::string::npos)
+            {
+                return readTable(text, "get_double_right()", number_of_harmonics * responses_size, right);
+            }
+
+            // the right ear is the left ear multiplied by the sign mask
+            std::vector<double> mask;
+            if(!readTable(text, "get_double_right_sign_mask()", number_of_harmonics, mask))
+            {
+                return false;
+            }
+
+            right.resize(left.size());
+            for(size_t i = 0; i < left.size(); i++)
+            {
+                right[i] = mask[i % number_of_harmonics] * left[i];
+            }
+            return true;
+        }
+
+    private:
+
+        //! @brief Replaces the includes of the sharded tables by the content of the files.
+        static std::string expandIncludes(std::string const& text, std::string const& folder)
+        {
+            const std::string key = "#include \"";
+            std::string result;
+            size_t current = 0;
+            for(auto pos = text.find(key); pos != std::string::npos; pos = text.find(key, current))
+            {
+                const auto end = text.find('"', pos + key.size());
+                if(end == std::string::npos)
+                {
+                    break;
+                }
+
+                result.append(text, current, pos - current);
+                std::ifstream shard(folder + text.substr(pos + key.size(), end - pos - key.size()));
+                std::stringstream ss;
+                ss << shard.rdbuf();
+                result += ss.str();
+                current = end + 1;
+            }
+
+            result.append(text, current, std::string::npos);
+            return result;
+        }
+
+        static bool readConstant(std::string const& text, std::string const& name, size_t& value)
+        {
+            const auto key = "static const size_t " + name + " = ";
+            const auto pos = text.find(key);
+            if(pos == std::string::npos)
+            {
+                return false;
+            }
+
+            value = size_t(std::strtoull(text.c_str() + pos + key.size(), nullptr, 10));
+            return true;
+        }
+
+        static bool readTable(std::string const& text, std::string const& name, size_t size, std::vector<double>& table)
+        {
+            auto pos = text.find(name);
+            pos = (pos != std::string::npos) ? text.find("data[] = {", pos) : pos;
+            if(pos == std::string::npos)
+            {
+                return false;
+            }
+
+            table.assign(size, 0.);
+
+            char const* current = text.c_str() + pos + 10;
+            for(auto& value : table)
+            {
+                char* end = nullptr;
+                value = std::strtod(current, &end);
+                if(end == current)
+                {
+                    return false;
+                }
+
+                // skips the separator ", "
+                current = end;
+                while(*current == ',' || *current == ' ')
+                {
+                    ++current;
+                }
+            }
+
+            return true;
+        }
+    };
+
+    // ================================================================================ //
+    // Binauralizer
+    // ================================================================================ //
+
+    //! @brief The binauralizer renders ambisonic files to binaural files with the HRIR matrices.
+    //! @details The files are streamed by blocks and convolved with an overlap-add FFT
+    //! convolution. The left and right filters of a harmonic are packed in one complex
+    //! spectrum (left + i.right) so one inverse FFT gives both ears, and the harmonics
+    //! are transformed by pairs (a + i.b) so one forward FFT gives two spectra.
+    //! The filters are shared and read-only, a binauralizer can render several
+    //! files concurrently, each render only allocates its own block buffers.
+    class Binauralizer
+    {
+    public:
+
+        using complex_t = std::complex<float>;
+
+        struct Report
+        {
+            bool        valid = false;
+            std::string error {};
+            size_t      frames = 0;
+            double      duration = 0.;
+            double      elapsed = 0.;
+
+            double getRealtimeFactor() const noexcept
+            {
+                return elapsed > 0. ? duration / elapsed : 0.;
+            }
+        };
+
+        Binauralizer(HrirMatrices const& matrices, size_t block_size)
+        : m_block_size(block_size)
+        , m_filter_size(matrices.responses_size)
+        , m_number_of_harmonics(matrices.number_of_harmonics)
+        , m_fft(Fft<float>::getPowerOfTwo(block_size + std::max(matrices.responses_size, size_t(1)) - 1))
+        , m_filters(matrices.number_of_harmonics * m_fft.getSize())
+        {
+            const auto fft_size = m_fft.getSize();
+            for(size_t k = 0; k < m_number_of_harmonics; k++)
+            {
+                complex_t* filter = m_filters.data() + k * fft_size;
+                for(size_t j = 0; j < m_filter_size; j++)
+                {
+                    const auto index = j * m_number_of_harmonics + k;
+                    filter[j] = complex_t(float(matrices.left[index]), float(matrices.right[index]));
+                }
+                m_fft.forward(filter);
+            }
+        }
+
+        ~Binauralizer() = default;
+
+        inline size_t getNumberOfHarmonics() const noexcept
+        {
+            return m_number_of_harmonics;
+        }
+
+        //! @brief Renders an ambisonic file to a stereo binaural file.
+        Report render(std::string const& input_path, std::string const& output_path) const
+        {
+            Report report;
+            const auto start = std::chrono::steady_clock::now();
+
+            SndfileHandle input(input_path);
+            if(!input || size_t(input.channels()) != m_number_of_harmonics)
+            {
+                report.error = "can't load " + input_path + " with "
+                + std::to_string(m_number_of_harmonics) + " channels";
+                return report;
+            }
+
+            SndfileHandle output(output_path, SFM_WRITE, SF_FORMAT_WAV | SF_FORMAT_FLOAT, 2, input.samplerate());
+            if(!output)
+            {
+                report.error = "can't write " + output_path;
+                return report;
+            }
+
+            const auto fft_size = m_fft.getSize();
+            const auto block_size = m_block_size;
+            const auto nh = m_number_of_harmonics;
+            const float scale = 1.f / float(fft_size);
+
+            std::vector<float> interleaved (block_size * nh, 0.f);
+            std::vector<float> stereo (block_size * 2, 0.f);
+            std::vector<complex_t> pair (fft_size);
+            std::vector<complex_t> spectrum (fft_size);
+            std::vector<complex_t> overlap (fft_size, complex_t(0.f, 0.f));
+
+            const size_t tail_size = m_filter_size ? m_filter_size - 1 : 0;
+            size_t remaining_tail = tail_size;
+            bool input_ended = false;
+
+            while(!input_ended || remaining_tail > 0)
+            {
+                size_t count = 0;
+                if(!input_ended)
+                {
+                    count = size_t(input.readf(interleaved.data(), sf_count_t(block_size)));
+                    std::fill(interleaved.begin() + long(count * nh), interleaved.end(), 0.f);
+                    input_ended = (count < block_size);
+                    report.frames += count;
+                }
+                else
+                {
+                    std::fill(interleaved.begin(), interleaved.end(), 0.f);
+                }
+
+                std::fill(spectrum.begin(), spectrum.end(), complex_t(0.f, 0.f));
+
+                for(size_t k = 0; k < nh; k += 2)
+                {
+                    const bool paired = (k + 1 < nh);
+                    for(size_t i = 0; i < block_size; i++)
+                    {
+                        pair[i] = complex_t(interleaved[i * nh + k], paired ? interleaved[i * nh + k + 1] : 0.f);
+                    }
+                    std::fill(pair.begin() + long(block_size), pair.end(), complex_t(0.f, 0.f));
+
+                    m_fft.forward(pair.data());
+                    accumulate(pair.data(), k, paired, spectrum.data());
+                }
+
+                m_fft.inverse(spectrum.data());
+
+                for(size_t i = 0; i < fft_size; i++)
+                {
+                    overlap[i] += spectrum[i] * scale;
+                }
+
+                // the last block only writes the samples left in the tail.
+                size_t frames = count;
+                if(input_ended)
+                {
+                    const size_t flushed = std::min(remaining_tail, block_size - count);
+                    frames += flushed;
+                    remaining_tail -= flushed;
+                }
+
+                for(size_t i = 0; i < frames; i++)
+                {
+                    stereo[i * 2] = overlap[i].real();
+                    stereo[i * 2 + 1] = overlap[i].imag();
+                }
+
+                output.writef(stereo.data(), sf_count_t(frames));
+
+                std::move(overlap.begin() + long(block_size), overlap.end(), overlap.begin());
+                std::fill(overlap.end() - long(block_size), overlap.end(), complex_t(0.f, 0.f));
+            }
+
+            const auto end = std::chrono::steady_clock::now();
+            report.valid = true;
+            report.duration = input.samplerate() > 0 ? double(report.frames) / double(input.samplerate()) : 0.;
+            report.elapsed = std::chrono::duration<double>(end - start).count();
+            return report;
+        }
+
+    private:
+
+        //! @brief Separates the spectra of a pair of harmonics and accumulates their filtered spectra.
+        void accumulate(complex_t const* pair, size_t harmonic, bool paired, complex_t* spectrum) const noexcept
+        {
+            const auto fft_size = m_fft.getSize();
+            complex_t const* filter_a = m_filters.data() + harmonic * fft_size;
+
+            if(!paired)
+            {
+                for(size_t f = 0; f < fft_size; f++)
+                {
+                    spectrum[f] += pair[f] * filter_a[f];
+                }
+                return;
+            }
+
+            complex_t const* filter_b = filter_a + fft_size;
+            for(size_t f = 0; f < fft_size; f++)
+            {
+                const complex_t z = pair[f];
+                const complex_t zc = std::conj(pair[(fft_size - f) & (fft_size - 1)]);
+                const complex_t a = (z + zc) * 0.5f;
+                const complex_t b = (z - zc) * complex_t(0.f, -0.5f);
+                spectrum[f] += a * filter_a[f] + b * filter_b[f];
+            }
+        }
+
+        const size_t            m_block_size;
+        const size_t            m_filter_size;
+        const size_t            m_number_of_harmonics;
+        const Fft<float>        m_fft;
+        std::vector<complex_t>  m_filters;
+    };
+}
@@ -0,0 +1,577 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include "Dispatch.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <iterator>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // Compressed matrix format
+    // ================================================================================ //
+
+    //! @brief The compressed format stores the harmonic filters of the matrices.
+    //! @details All the values are little endian.
+    //! header : "HOAH", version (u8), dimension (u8), order (u32),
+    //! number of harmonics (u32), responses size (u32), number of tables (u32), flags (u8).
+    //! If the symmetric flag is set, the right tables are not stored and the sign mask
+    //! of the right ear follows (one i8 per harmonic). Then for each table and each harmonic filter : step (f32), length (u32),
+    //! predictor (u8), payload size (u32) and the payload.
+    //! A filter is quantized with a step that gives the target signal to noise ratio,
+    //! the tail of zeros is dropped (length), the values are optionally predicted
+    //! from the previous one and the residuals are Rice coded by blocks of 32 values,
+    //! each block starting with its 5 bits Rice parameter.
+    //! The step is increased if needed so the quantized values stay below 2^30 and
+    //! their differences fit in 32 bits, this lowers the SNR of extreme filters.
+    namespace codec
+    {
+        static constexpr char     magic[4] = {'H', 'O', 'A', 'H'};
+        static constexpr uint8_t  version = 2;
+        static constexpr uint8_t  symmetric_flag = 1;
+        static constexpr size_t   block_size = 32;
+        static constexpr uint32_t escape_quotient = 24;
+        static constexpr double   max_quantized = double((1 << 30) - 1);
+
+        enum class Predictor : uint8_t
+        {
+            None = 0,
+            Previous
+        };
+
+        static inline uint32_t zigzag(int32_t value) noexcept
+        {
+            return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+        }
+
+        static inline int32_t unzigzag(uint32_t value) noexcept
+        {
+            return int32_t(value >> 1) ^ -int32_t(value & 1);
+        }
+
+        // ================================================================================ //
+        // BitWriter
+        // ================================================================================ //
+
+        class BitWriter
+        {
+        public:
+
+            void write(uint32_t value, uint32_t bits)
+            {
+                for(uint32_t i = 0; i < bits; i++)
+                {
+                    writeBit((value >> i) & 1u);
+                }
+            }
+
+            void writeBit(uint32_t bit)
+            {
+                m_current |= uint8_t(bit << m_bits);
+                if(++m_bits == 8)
+                {
+                    m_bytes.push_back(m_current);
+                    m_current = 0;
+                    m_bits = 0;
+                }
+            }
+
+            std::vector<uint8_t> flush()
+            {
+                if(m_bits)
+                {
+                    m_bytes.push_back(m_current);
+                }
+
+                m_current = 0;
+                m_bits = 0;
+                return std::move(m_bytes);
+            }
+
+        private:
+
+            std::vector<uint8_t> m_bytes {};
+            uint8_t m_current = 0;
+            uint32_t m_bits = 0;
+        };
+
+        // ================================================================================ //
+        // BitReader
+        // ================================================================================ //
+
+        class BitReader
+        {
+        public:
+
+            BitReader() = default;
+
+            BitReader(uint8_t const* data, size_t size)
+            : m_data(data)
+            , m_size(size)
+            {}
+
+            //! @brief Reads bits (at most 32), the reader returns zeros past the end of the payload.
+            inline uint32_t read(uint32_t bits) noexcept
+            {
+                refill();
+                const uint64_t mask = (bits == 32) ? 0xffffffffull : ((uint64_t(1) << bits) - 1);
+                const uint32_t value = uint32_t(m_buffer & mask);
+                m_buffer >>= bits;
+                m_available -= std::min(m_available, bits);
+                return value;
+            }
+
+            //! @brief Reads a unary code of ones terminated by a zero, saturated to the maximum.
+            inline uint32_t readUnary(uint32_t maximum) noexcept
+            {
+                uint32_t count = 0;
+                while(count < maximum && read(1))
+                {
+                    ++count;
+                }
+                return count;
+            }
+
+        private:
+
+            inline void refill() noexcept
+            {
+                while(m_available <= 56)
+                {
+                    const uint64_t byte = m_position < m_size ? m_data[m_position] : 0;
+                    m_buffer |= byte << m_available;
+                    m_available += 8;
+                    ++m_position;
+                }
+            }
+
+            uint8_t const* m_data = nullptr;
+            size_t   m_size = 0;
+            size_t   m_position = 0;
+            uint64_t m_buffer = 0;
+            uint32_t m_available = 0;
+        };
+
+        // ================================================================================ //
+        // FilterEncoder
+        // ================================================================================ //
+
+        struct EncodedFilter
+        {
+            float                   step = 0.f;
+            uint32_t                length = 0;
+            Predictor               predictor = Predictor::None;
+            std::vector<uint8_t>    payload {};
+        };
+
+        static inline uint64_t getRiceCost(uint32_t const* values, size_t size, uint32_t k) noexcept
+        {
+            uint64_t cost = 0;
+            for(size_t i = 0; i < size; i++)
+            {
+                const uint32_t quotient = values[i] >> k;
+                cost += (quotient < escape_quotient) ? (quotient + 1 + k) : (escape_quotient + 32);
+            }
+            return cost;
+        }
+
+        static inline std::vector<uint8_t> encodeResiduals(std::vector<int32_t> const& residuals)
+        {
+            BitWriter writer;
+            std::vector<uint32_t> values (block_size);
+
+            for(size_t start = 0; start < residuals.size(); start += block_size)
+            {
+                const size_t size = std::min(block_size, residuals.size() - start);
+                for(size_t i = 0; i < size; i++)
+                {
+                    values[i] = zigzag(residuals[start + i]);
+                }
+
+                uint32_t best_k = 0;
+                uint64_t best_cost = getRiceCost(values.data(), size, 0);
+                for(uint32_t k = 1; k < 31; k++)
+                {
+                    const uint64_t cost = getRiceCost(values.data(), size, k);
+                    if(cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_k = k;
+                    }
+                }
+
+                writer.write(best_k, 5);
+                for(size_t i = 0; i < size; i++)
+                {
+                    const uint32_t quotient = values[i] >> best_k;
+                    if(quotient < escape_quotient)
+                    {
+                        writer.write((1u << quotient) - 1u, quotient + 1);
+                        writer.write(values[i], best_k);
+                    }
+                    else
+                    {
+                        writer.write(0xffffffffu, escape_quotient);
+                        writer.write(values[i], 32);
+                    }
+                }
+            }
+
+            return writer.flush();
+        }
+
+        //! @brief Encodes a filter (values separated by a stride) for a target signal to noise ratio in dB.
+        static inline EncodedFilter encodeFilter(double const* values, size_t size, size_t stride, double snr)
+        {
+            EncodedFilter filter;
+
+            double energy = 0.;
+            double peak = 0.;
+            for(size_t j = 0; j < size; j++)
+            {
+                energy += values[j * stride] * values[j * stride];
+                peak = std::max(peak, std::abs(values[j * stride]));
+            }
+
+            if(energy <= 0.)
+            {
+                return filter;
+            }
+
+            // a uniform quantizer adds a noise power of step^2 / 12.
+            const double rms = std::sqrt(energy / double(size));
+            const double step = rms * std::sqrt(12.) * std::pow(10., -snr / 20.);
+            filter.step = float(std::max(step, peak / max_quantized));
+
+            std::vector<int32_t> quantized (size, 0);
+            for(size_t j = 0; j < size; j++)
+            {
+                const double value = std::round(values[j * stride] / double(filter.step));
+                quantized[j] = int32_t(std::max(-max_quantized, std::min(max_quantized, value)));
+                if(quantized[j] != 0)
+                {
+                    filter.length = uint32_t(j + 1);
+                }
+            }
+
+            quantized.resize(filter.length);
+
+            std::vector<int32_t> deltas (quantized.size(), 0);
+            for(size_t j = 0; j < quantized.size(); j++)
+            {
+                deltas[j] = quantized[j] - (j ? quantized[j-1] : 0);
+            }
+
+            auto raw_payload = encodeResiduals(quantized);
+            auto delta_payload = encodeResiduals(deltas);
+
+            if(delta_payload.size() < raw_payload.size())
+            {
+                filter.predictor = Predictor::Previous;
+                filter.payload = std::move(delta_payload);
+            }
+            else
+            {
+                filter.payload = std::move(raw_payload);
+            }
+
+            return filter;
+        }
+
+        // ================================================================================ //
+        // FilterDecoder
+        // ================================================================================ //
+
+        //! @brief The filter decoder unpacks a filter progressively.
+        //! @details Each call to read() continues where the previous one stopped, so the
+        //! filter can be decoded partition by partition directly in the buffers of a
+        //! partitioned convolver. The Rice codes are serial so the bits are unpacked
+        //! value by value in an integer block, the block is then integrated and
+        //! dequantized with the dispatched kernel.
+        class FilterDecoder
+        {
+        public:
+
+            FilterDecoder() = default;
+
+            FilterDecoder(uint8_t const* payload, size_t payload_size,
+                          float step, uint32_t length, Predictor predictor)
+            : m_reader(payload, payload_size)
+            , m_step(step)
+            , m_length(length)
+            , m_predictor(predictor)
+            {}
+
+            //! @brief Decodes the next values of the filter, the values past its length are zeros.
+            void read(float* output, size_t count) noexcept
+            {
+                while(count)
+                {
+                    if(m_position >= m_length)
+                    {
+                        std::fill(output, output + count, 0.f);
+                        m_position += count;
+                        return;
+                    }
+
+                    if(m_block_remaining == 0)
+                    {
+                        m_k = m_reader.read(5);
+                        m_block_remaining = uint32_t(std::min(block_size, size_t(m_length - m_position)));
+                    }
+
+                    const size_t size = std::min(count, size_t(m_block_remaining));
+
+                    for(size_t i = 0; i < size; i++)
+                    {
+                        const uint32_t quotient = m_reader.readUnary(escape_quotient);
+                        const uint32_t value = (quotient < escape_quotient)
+                        ? ((quotient << m_k) | m_reader.read(m_k))
+                        : m_reader.read(32);
+                        m_block[i] = unzigzag(value);
+                    }
+
+                    if(m_predictor == Predictor::Previous)
+                    {
+                        int32_t previous = m_previous;
+                        for(size_t i = 0; i < size; i++)
+                        {
+                            previous += m_block[i];
+                            m_block[i] = previous;
+                        }
+                        m_previous = previous;
+                    }
+
+                    Dispatch::getKernels().dequantize(output, m_block, m_step, size);
+
+                    output += size;
+                    count -= size;
+                    m_position += size;
+                    m_block_remaining -= uint32_t(size);
+                }
+            }
+
+        private:
+
+            BitReader   m_reader {};
+            float       m_step = 0.f;
+            uint32_t    m_length = 0;
+            Predictor   m_predictor = Predictor::None;
+            size_t      m_position = 0;
+            uint32_t    m_block_remaining = 0;
+            uint32_t    m_k = 0;
+            int32_t     m_previous = 0;
+            int32_t     m_block[block_size] = {};
+        };
+
+        // ================================================================================ //
+        // CompressedMatrices
+        // ================================================================================ //
+
+        //! @brief The compressed matrices own the encoded filters of several tables.
+        class CompressedMatrices
+        {
+        public:
+
+            uint8_t     dimension = 0;
+            uint32_t    order = 0;
+            uint32_t    number_of_harmonics = 0;
+            uint32_t    responses_size = 0;
+            std::vector<int8_t> right_sign_mask {}; //! empty if the right tables are stored
+
+            //! @brief Returns true if the right ear is the left ear multiplied by the sign mask.
+            inline bool isSymmetric() const noexcept
+            {
+                return !right_sign_mask.empty();
+            }
+
+            //! @brief Encodes a matrix (responses size x number of harmonics, sample major) as a new table.
+            void addTable(std::vector<double> const& matrix, double snr)
+            {
+                std::vector<EncodedFilter> table;
+                for(size_t k = 0; k < number_of_harmonics; k++)
+                {
+                    table.emplace_back(encodeFilter(matrix.data() + k, responses_size, number_of_harmonics, snr));
+                }
+                m_tables.emplace_back(std::move(table));
+            }
+
+            inline size_t getNumberOfTables() const noexcept
+            {
+                return m_tables.size();
+            }
+
+            //! @brief Returns a streaming decoder for a filter, the compressed matrices must outlive it.
+            FilterDecoder getDecoder(size_t table, size_t harmonic) const
+            {
+                auto const& filter = m_tables[table][harmonic];
+                return {filter.payload.data(), filter.payload.size(), filter.step, filter.length, filter.predictor};
+            }
+
+            //! @brief Decodes a full table in a matrix (responses size x number of harmonics, sample major).
+            void decodeTable(size_t table, std::vector<double>& matrix) const
+            {
+                matrix.assign(size_t(responses_size) * number_of_harmonics, 0.);
+                std::vector<float> filter (responses_size);
+                for(size_t k = 0; k < number_of_harmonics; k++)
+                {
+                    getDecoder(table, k).read(filter.data(), filter.size());
+                    for(size_t j = 0; j < responses_size; j++)
+                    {
+                        matrix[j * number_of_harmonics + k] = filter[j];
+                    }
+                }
+            }
+
+            void write(std::ostream& stream) const
+            {
+                stream.write(magic, 4);
+                writeValue(stream, version);
+                writeValue(stream, dimension);
+                writeValue(stream, order);
+                writeValue(stream, number_of_harmonics);
+                writeValue(stream, responses_size);
+                writeValue(stream, uint32_t(m_tables.size()));
+                writeValue(stream, uint8_t(isSymmetric() ? symmetric_flag : 0));
+                for(auto const& sign : right_sign_mask)
+                {
+                    writeValue(stream, sign);
+                }
+
+                for(auto const& table : m_tables)
+                {
+                    for(auto const& filter : table)
+                    {
+                        writeValue(stream, filter.step);
+                        writeValue(stream, filter.length);
+                        writeValue(stream, uint8_t(filter.predictor));
+                        writeValue(stream, uint32_t(filter.payload.size()));
+                        stream.write(reinterpret_cast<char const*>(filter.payload.data()), std::streamsize(filter.payload.size()));
+                    }
+                }
+            }
+
+            //! @brief Reads the compressed matrices, returns false if the stream is not valid.
+            bool read(std::istream& stream)
+            {
+                char header[4] = {};
+                uint8_t file_version = 0;
+                uint32_t number_of_tables = 0;
+                uint8_t flags = 0;
+
+                stream.read(header, 4);
+                if(!stream || std::memcmp(header, magic, 4) != 0
+                   || !readValue(stream, file_version) || file_version != version
+                   || !readValue(stream, dimension) || !readValue(stream, order)
+                   || !readValue(stream, number_of_harmonics) || !readValue(stream, responses_size)
+                   || !readValue(stream, number_of_tables) || !readValue(stream, flags))
+                {
+                    return false;
+                }
+
+                right_sign_mask.assign((flags & symmetric_flag) ? number_of_harmonics : 0, 1);
+                for(auto& sign : right_sign_mask)
+                {
+                    if(!readValue(stream, sign) || (sign != 1 && sign != -1))
+                    {
+                        return false;
+                    }
+                }
+
+                m_tables.assign(number_of_tables, std::vector<EncodedFilter>(number_of_harmonics));
+                for(auto& table : m_tables)
+                {
+                    for(auto& filter : table)
+                    {
+                        uint8_t predictor = 0;
+                        uint32_t payload_size = 0;
+                        if(!readValue(stream, filter.step) || !readValue(stream, filter.length)
+                           || !readValue(stream, predictor) || !readValue(stream, payload_size))
+                        {
+                            return false;
+                        }
+
+                        filter.predictor = Predictor(predictor);
+                        filter.payload.resize(payload_size);
+                        stream.read(reinterpret_cast<char*>(filter.payload.data()), std::streamsize(payload_size));
+                        if(!stream || filter.length > responses_size)
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                return true;
+            }
+
+            //! @brief Returns the size of the payloads in bytes.
+            size_t getPayloadSize() const noexcept
+            {
+                size_t size = 0;
+                for(auto const& table : m_tables)
+                {
+                    for(auto const& filter : table)
+                    {
+                        size += filter.payload.size();
+                    }
+                }
+                return size;
+            }
+
+        private:
+
+            template<typename T>
+            static void writeValue(std::ostream& stream, T value)
+            {
+                uint8_t bytes[sizeof(T)];
+                std::memcpy(bytes, &value, sizeof(T));
+                for(size_t i = 0; i < sizeof(T); i++)
+                {
+                    stream.put(char(isLittleEndian() ? bytes[i] : bytes[sizeof(T) - 1 - i]));
+                }
+            }
+
+            template<typename T>
+            static bool readValue(std::istream& stream, T& value)
+            {
+                uint8_t bytes[sizeof(T)];
+                for(size_t i = 0; i < sizeof(T); i++)
+                {
+                    const auto c = stream.get();
+                    if(c == std::char_traits<char>::eof())
+                    {
+                        return false;
+                    }
+                    bytes[isLittleEndian() ? i : sizeof(T) - 1 - i] = uint8_t(c);
+                }
+                std::memcpy(&value, bytes, sizeof(T));
+                return true;
+            }
+
+            static bool isLittleEndian() noexcept
+            {
+                const uint16_t value = 1;
+                uint8_t byte = 0;
+                std::memcpy(&byte, &value, 1);
+                return byte == 1;
+            }
+
+            std::vector<std::vector<EncodedFilter>> m_tables {};
+        };
+    }
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "System.hpp"
+#include "Accumulator.hpp"
 #include "../ThirdParty/HoaLibrary/Sources/Hoa.hpp"
 
 #include <set>
@@ -22,6 +23,14 @@ namespace hoa::hrir_matrix_creator
         Sadie
     };
     
+    //! @brief The ear symmetry derives the right ear from the left ear mirrored across the median plane.
+    enum class Symmetry
+    {
+        None = 0,
+        MirrorLeft,         //! only the left ear is projected
+        AverageMirrored     //! the left ear is averaged with the mirrored right ear
+    };
+    
     struct Config
     {
         size_t order = 0;                           //! required
@@ -34,6 +43,22 @@ namespace hoa::hrir_matrix_creator
         std::string file_extension = ".hpp";        //! optional
         std::string output_directory = "./";        //! optional
         std::set<std::string> wave_files = {};      //! optional
+        std::set<size_t> orders = {};               //! optional (overrides order, one file per order)
         std::string notes {};                       //! optional
+        double low_rank_energy = 0.;                //! optional (0 disables, ratio of energy kept)
+        Accumulation accumulation = Accumulation::Double; //! optional
+        bool check_accumulation = false;            //! optional (also runs the double accumulation and compares)
+        double accumulation_tolerance = 1e-6;       //! optional (relative to the matrices peak)
+        bool write_compressed = false;              //! optional (writes a compressed binary file)
+        std::string compressed_extension = ".hoahrir"; //! optional
+        double compressed_snr = 90.;                //! optional (target SNR in dB of each filter)
+        bool split_by_radius = false;               //! optional (one matrix per measured distance)
+        double reference_radius = 0.;               //! optional (near-field reference, 0 uses the largest distance)
+        double speed_of_sound = 343.;               //! optional
+        bool write_analysis = false;                //! optional (writes the reconstruction error report)
+        size_t number_of_threads = 0;               //! optional (0 uses the hardware concurrency)
+        Symmetry symmetry = Symmetry::None;         //! optional (writes the left ear and a sign mask)
+        size_t shard_size = 0;                      //! optional (values per included .inc file, 0 writes the tables inline)
+        bool verbose = true;                        //! optional (prints the reports of the projection)
     };
 }
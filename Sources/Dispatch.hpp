@@ -0,0 +1,435 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <ostream>
+#include <atomic>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HOA_HRIR_X86_DISPATCH 1
+#define HOA_HRIR_INLINE inline __attribute__((always_inline))
+// the variants don't contract the multiplications and the additions so they all give the same results.
+#if defined(__clang__)
+#define HOA_HRIR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define HOA_HRIR_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#endif
+#else
+#define HOA_HRIR_X86_DISPATCH 0
+#define HOA_HRIR_INLINE inline
+#endif
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // Kernels
+    // ================================================================================ //
+
+    //! @brief The kernels of the heavy loops, written once and compiled for several instruction sets.
+    //! @details The kernels are always inlined in the variants so each variant vectorizes
+    //! the loops with its own instruction set. The additions and the multiplications are
+    //! separated in distinct statements and never contracted in fused multiply-adds.
+    namespace kernels
+    {
+        //! @brief Accumulates the outer product of the samples and the harmonics (sample major).
+        template<typename = void>
+        HOA_HRIR_INLINE void project(double* output, double const* samples, double const* harmonics,
+                                     size_t size, size_t number_of_harmonics) noexcept
+        {
+            for(size_t j = 0; j < size; j++)
+            {
+                const double sample = samples[j];
+                double* row = output + j * number_of_harmonics;
+                for(size_t k = 0; k < number_of_harmonics; k++)
+                {
+                    const double product = sample * harmonics[k];
+                    row[k] += product;
+                }
+            }
+        }
+
+        //! @brief Adds gain * values to the sums with a Kahan compensation.
+        template<typename = void>
+        HOA_HRIR_INLINE void accumulateCompensated(float* sums, float* compensations, float const* values,
+                                                   float gain, size_t size) noexcept
+        {
+            for(size_t i = 0; i < size; i++)
+            {
+                const float product = gain * values[i];
+                const float y = product - compensations[i];
+                const float t = sums[i] + y;
+                compensations[i] = (t - sums[i]) - y;
+                sums[i] = t;
+            }
+        }
+
+        //! @brief Converts integer samples to double samples.
+        template<typename = void>
+        HOA_HRIR_INLINE void convert(double* output, int32_t const* input, double scale, size_t size) noexcept
+        {
+            for(size_t i = 0; i < size; i++)
+            {
+                output[i] = double(input[i]) * scale;
+            }
+        }
+
+        //! @brief Dequantizes integer values with a step.
+        template<typename = void>
+        HOA_HRIR_INLINE void dequantize(float* output, int32_t const* input, float step, size_t size) noexcept
+        {
+            for(size_t i = 0; i < size; i++)
+            {
+                output[i] = float(input[i]) * step;
+            }
+        }
+    }
+
+    // ================================================================================ //
+    // Dispatch
+    // ================================================================================ //
+
+    //! @brief The dispatch selects the variant of the kernels for the instruction set of the CPU.
+    //! @details The best supported instruction set is selected the first time the kernels
+    //! are requested. It can be overridden with the environment variable HOA_HRIR_ISA
+    //! or with setIsa() (generic, avx2 or avx512), an unsupported instruction set
+    //! falls back to the best supported one.
+    class Dispatch
+    {
+    public:
+
+        enum class Isa
+        {
+            Generic = 0,
+            Avx2,
+            Avx512
+        };
+
+        struct Kernels
+        {
+            void (*project)(double*, double const*, double const*, size_t, size_t) noexcept;
+            void (*accumulateCompensated)(float*, float*, float const*, float, size_t) noexcept;
+            void (*convert)(double*, int32_t const*, double, size_t) noexcept;
+            void (*dequantize)(float*, int32_t const*, float, size_t) noexcept;
+        };
+
+        //! @brief Returns the kernels of the selected instruction set.
+        static Kernels const& getKernels() noexcept
+        {
+            return getKernels(getIsa());
+        }
+
+        //! @brief Returns the kernels of an instruction set.
+        static Kernels const& getKernels(Isa isa) noexcept
+        {
+            static const Kernels generic {&project<Isa::Generic>, &accumulateCompensated<Isa::Generic>, &convert<Isa::Generic>, &dequantize<Isa::Generic>};
+#if HOA_HRIR_X86_DISPATCH
+            static const Kernels avx2 {&project<Isa::Avx2>, &accumulateCompensated<Isa::Avx2>, &convert<Isa::Avx2>, &dequantize<Isa::Avx2>};
+            static const Kernels avx512 {&project<Isa::Avx512>, &accumulateCompensated<Isa::Avx512>, &convert<Isa::Avx512>, &dequantize<Isa::Avx512>};
+            switch(isa)
+            {
+                case Isa::Avx2 : return avx2;
+                case Isa::Avx512 : return avx512;
+                default : break;
+            }
+#endif
+            (void)isa;
+            return generic;
+        }
+
+        //! @brief Returns the selected instruction set.
+        static Isa getIsa() noexcept
+        {
+            auto& selected = getSelected();
+            int isa = selected.load();
+            if(isa < 0)
+            {
+                isa = int(getDefaultIsa());
+                selected.store(isa);
+            }
+            return Isa(isa);
+        }
+
+        //! @brief Selects an instruction set, the best supported one is used if it isn't supported.
+        static void setIsa(Isa isa) noexcept
+        {
+            getSelected().store(int(isSupported(isa) ? isa : getBestIsa()));
+        }
+
+        //! @brief Selects an instruction set by name, returns false if the name is unknown.
+        static bool setIsa(std::string const& name) noexcept
+        {
+            Isa isa;
+            if(!getIsa(name, isa))
+            {
+                return false;
+            }
+
+            setIsa(isa);
+            return true;
+        }
+
+        static bool isSupported(Isa isa) noexcept
+        {
+            switch(isa)
+            {
+                case Isa::Generic : return true;
+#if HOA_HRIR_X86_DISPATCH
+                case Isa::Avx2 : return __builtin_cpu_supports("avx2");
+                case Isa::Avx512 : return __builtin_cpu_supports("avx512f");
+#endif
+                default : return false;
+            }
+        }
+
+        static Isa getBestIsa() noexcept
+        {
+            return isSupported(Isa::Avx512) ? Isa::Avx512 : (isSupported(Isa::Avx2) ? Isa::Avx2 : Isa::Generic);
+        }
+
+        static char const* getName(Isa isa) noexcept
+        {
+            switch(isa)
+            {
+                case Isa::Avx2 : return "avx2";
+                case Isa::Avx512 : return "avx512";
+                default : return "generic";
+            }
+        }
+
+        //! @brief Runs all the supported variants on the same data and checks that the results are identical.
+        static bool checkKernels(std::ostream& stream)
+        {
+            const size_t size = 257, number_of_harmonics = 49;
+            std::mt19937 generator(1);
+            std::uniform_real_distribution<double> distribution(-1., 1.);
+
+            std::vector<double> samples (size), harmonics (number_of_harmonics);
+            std::vector<float> values (size * number_of_harmonics);
+            std::vector<int32_t> integers (size * 2);
+            for(auto& sample : samples) { sample = distribution(generator); }
+            for(auto& harmonic : harmonics) { harmonic = distribution(generator); }
+            for(auto& value : values) { value = float(distribution(generator)); }
+            for(auto& integer : integers) { integer = int32_t(distribution(generator) * 2147483647.); }
+
+            auto run = [&](Kernels const& kernels) {
+                std::vector<double> projection (size * number_of_harmonics, 0.);
+                std::vector<float> sums (values.size(), 0.f), compensations (values.size(), 0.f);
+                std::vector<double> converted (integers.size());
+                std::vector<float> dequantized (integers.size());
+                for(size_t i = 0; i < 4; i++)
+                {
+                    kernels.project(projection.data(), samples.data(), harmonics.data(), size, number_of_harmonics);
+                    kernels.accumulateCompensated(sums.data(), compensations.data(), values.data(), float(samples[i]), values.size());
+                }
+                kernels.convert(converted.data(), integers.data(), 1. / 2147483648., integers.size());
+                kernels.dequantize(dequantized.data(), integers.data(), 1.f / 65536.f, integers.size());
+
+                std::vector<uint8_t> bytes;
+                auto append = [&bytes](void const* data, size_t count) {
+                    auto const* begin = static_cast<uint8_t const*>(data);
+                    bytes.insert(bytes.end(), begin, begin + count);
+                };
+                append(projection.data(), projection.size() * sizeof(double));
+                append(sums.data(), sums.size() * sizeof(float));
+                append(compensations.data(), compensations.size() * sizeof(float));
+                append(converted.data(), converted.size() * sizeof(double));
+                append(dequantized.data(), dequantized.size() * sizeof(float));
+                return bytes;
+            };
+
+            const auto reference = run(getKernels(Isa::Generic));
+            bool valid = true;
+            for(auto isa : {Isa::Generic, Isa::Avx2, Isa::Avx512})
+            {
+                if(!isSupported(isa))
+                {
+                    stream << getName(isa) << " : not supported\n";
+                    continue;
+                }
+
+                const bool identical = (run(getKernels(isa)) == reference);
+                valid = valid && identical;
+                stream << getName(isa) << " : " << (identical ? "identical" : "different") << "\n";
+            }
+
+            return valid;
+        }
+
+    private:
+
+        static std::atomic<int>& getSelected() noexcept
+        {
+            static std::atomic<int> selected {-1};
+            return selected;
+        }
+
+        static bool getIsa(std::string const& name, Isa& isa) noexcept
+        {
+            for(auto candidate : {Isa::Generic, Isa::Avx2, Isa::Avx512})
+            {
+                if(name == getName(candidate))
+                {
+                    isa = candidate;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static Isa getDefaultIsa() noexcept
+        {
+            Isa isa;
+            char const* name = std::getenv("HOA_HRIR_ISA");
+            if(name && getIsa(name, isa) && isSupported(isa))
+            {
+                return isa;
+            }
+            return getBestIsa();
+        }
+
+        template<Isa I>
+        static void project(double* output, double const* samples, double const* harmonics,
+                            size_t size, size_t number_of_harmonics) noexcept
+        {
+            if constexpr(I == Isa::Generic)
+            {
+                kernels::project(output, samples, harmonics, size, number_of_harmonics);
+            }
+#if HOA_HRIR_X86_DISPATCH
+            else if constexpr(I == Isa::Avx2)
+            {
+                projectAvx2(output, samples, harmonics, size, number_of_harmonics);
+            }
+            else
+            {
+                projectAvx512(output, samples, harmonics, size, number_of_harmonics);
+            }
+#endif
+        }
+
+        template<Isa I>
+        static void accumulateCompensated(float* sums, float* compensations, float const* values,
+                                          float gain, size_t size) noexcept
+        {
+            if constexpr(I == Isa::Generic)
+            {
+                kernels::accumulateCompensated(sums, compensations, values, gain, size);
+            }
+#if HOA_HRIR_X86_DISPATCH
+            else if constexpr(I == Isa::Avx2)
+            {
+                accumulateCompensatedAvx2(sums, compensations, values, gain, size);
+            }
+            else
+            {
+                accumulateCompensatedAvx512(sums, compensations, values, gain, size);
+            }
+#endif
+        }
+
+        template<Isa I>
+        static void convert(double* output, int32_t const* input, double scale, size_t size) noexcept
+        {
+            if constexpr(I == Isa::Generic)
+            {
+                kernels::convert(output, input, scale, size);
+            }
+#if HOA_HRIR_X86_DISPATCH
+            else if constexpr(I == Isa::Avx2)
+            {
+                convertAvx2(output, input, scale, size);
+            }
+            else
+            {
+                convertAvx512(output, input, scale, size);
+            }
+#endif
+        }
+
+        template<Isa I>
+        static void dequantize(float* output, int32_t const* input, float step, size_t size) noexcept
+        {
+            if constexpr(I == Isa::Generic)
+            {
+                kernels::dequantize(output, input, step, size);
+            }
+#if HOA_HRIR_X86_DISPATCH
+            else if constexpr(I == Isa::Avx2)
+            {
+                dequantizeAvx2(output, input, step, size);
+            }
+            else
+            {
+                dequantizeAvx512(output, input, step, size);
+            }
+#endif
+        }
+
+#if HOA_HRIR_X86_DISPATCH
+        HOA_HRIR_TARGET("avx2")
+        static void projectAvx2(double* output, double const* samples, double const* harmonics,
+                                size_t size, size_t number_of_harmonics) noexcept
+        {
+            kernels::project(output, samples, harmonics, size, number_of_harmonics);
+        }
+
+        HOA_HRIR_TARGET("avx512f")
+        static void projectAvx512(double* output, double const* samples, double const* harmonics,
+                                  size_t size, size_t number_of_harmonics) noexcept
+        {
+            kernels::project(output, samples, harmonics, size, number_of_harmonics);
+        }
+
+        HOA_HRIR_TARGET("avx2")
+        static void accumulateCompensatedAvx2(float* sums, float* compensations, float const* values,
+                                              float gain, size_t size) noexcept
+        {
+            kernels::accumulateCompensated(sums, compensations, values, gain, size);
+        }
+
+        HOA_HRIR_TARGET("avx512f")
+        static void accumulateCompensatedAvx512(float* sums, float* compensations, float const* values,
+                                                float gain, size_t size) noexcept
+        {
+            kernels::accumulateCompensated(sums, compensations, values, gain, size);
+        }
+
+        HOA_HRIR_TARGET("avx2")
+        static void convertAvx2(double* output, int32_t const* input, double scale, size_t size) noexcept
+        {
+            kernels::convert(output, input, scale, size);
+        }
+
+        HOA_HRIR_TARGET("avx512f")
+        static void convertAvx512(double* output, int32_t const* input, double scale, size_t size) noexcept
+        {
+            kernels::convert(output, input, scale, size);
+        }
+
+        HOA_HRIR_TARGET("avx2")
+        static void dequantizeAvx2(float* output, int32_t const* input, float step, size_t size) noexcept
+        {
+            kernels::dequantize(output, input, step, size);
+        }
+
+        HOA_HRIR_TARGET("avx512f")
+        static void dequantizeAvx512(float* output, int32_t const* input, float step, size_t size) noexcept
+        {
+            kernels::dequantize(output, input, step, size);
+        }
+#endif
+    };
+}
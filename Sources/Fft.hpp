@@ -0,0 +1,123 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cmath>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // Fft
+    // ================================================================================ //
+
+    //! @brief An iterative radix-2 complex FFT with precomputed twiddles.
+    //! @details The size must be a power of two. The transforms are done in place
+    //! and the inverse transform is not normalized.
+    template<typename T>
+    class Fft
+    {
+    public:
+
+        using complex_t = std::complex<T>;
+
+        Fft(size_t size)
+        : m_size(size)
+        , m_twiddles(size / 2)
+        , m_reversed(size)
+        {
+            const double pi = std::acos(-1.);
+            for(size_t i = 0; i < size / 2; i++)
+            {
+                const double angle = -2. * pi * double(i) / double(size);
+                m_twiddles[i] = complex_t(T(std::cos(angle)), T(std::sin(angle)));
+            }
+
+            size_t bits = 0;
+            while((size_t(1) << bits) < size)
+            {
+                ++bits;
+            }
+
+            for(size_t i = 0; i < size; i++)
+            {
+                size_t reversed = 0;
+                for(size_t b = 0; b < bits; b++)
+                {
+                    reversed |= ((i >> b) & 1) << (bits - 1 - b);
+                }
+                m_reversed[i] = reversed;
+            }
+        }
+
+        ~Fft() = default;
+
+        inline size_t getSize() const noexcept
+        {
+            return m_size;
+        }
+
+        //! @brief Returns the smallest power of two greater or equal to the size.
+        static size_t getPowerOfTwo(size_t size) noexcept
+        {
+            size_t power = 1;
+            while(power < size)
+            {
+                power <<= 1;
+            }
+            return power;
+        }
+
+        void forward(complex_t* data) const noexcept
+        {
+            transform(data, false);
+        }
+
+        void inverse(complex_t* data) const noexcept
+        {
+            transform(data, true);
+        }
+
+    private:
+
+        void transform(complex_t* data, bool inverse) const noexcept
+        {
+            for(size_t i = 0; i < m_size; i++)
+            {
+                if(i < m_reversed[i])
+                {
+                    std::swap(data[i], data[m_reversed[i]]);
+                }
+            }
+
+            for(size_t length = 2; length <= m_size; length <<= 1)
+            {
+                const size_t half = length / 2;
+                const size_t stride = m_size / length;
+                for(size_t start = 0; start < m_size; start += length)
+                {
+                    for(size_t i = 0; i < half; i++)
+                    {
+                        const complex_t twiddle = inverse ? std::conj(m_twiddles[i * stride]) : m_twiddles[i * stride];
+                        const complex_t even = data[start + i];
+                        const complex_t odd = data[start + i + half] * twiddle;
+                        data[start + i] = even + odd;
+                        data[start + i + half] = even - odd;
+                    }
+                }
+            }
+        }
+
+        size_t                  m_size;
+        std::vector<complex_t>  m_twiddles;
+        std::vector<size_t>     m_reversed;
+    };
+}
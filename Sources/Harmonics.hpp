@@ -0,0 +1,329 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include "../ThirdParty/HoaLibrary/Sources/Hoa.hpp"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <ostream>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // Harmonics
+    // ================================================================================ //
+
+    //! @brief The harmonics evaluates the real harmonics of arrays of directions.
+    //! @details The directions are given as separated arrays of azimuths and elevations
+    //! (radians) and the result is a directions x harmonics matrix. The directions are
+    //! processed by blocks, the recurrences of the associated Legendre functions and of
+    //! the sines and cosines of the multiple angles run over the directions of a block
+    //! so the inner loops are vectorized. The harmonics are ordered like the processor
+    //! of the HoaLibrary, in 3D they are semi-normalized (SN3D) or fully normalized (N3D),
+    //! in 2D they are the circular harmonics.
+    //! A weight per harmonic and a gain per direction can be applied to the result.
+    //! The evaluator is read-only once configured, it can be shared by several threads.
+    template<Dimension Dim>
+    class Harmonics
+    {
+    public:
+
+        enum class Normalization
+        {
+            Sn3d = 0,
+            N3d
+        };
+
+        using processor_t = ProcessorHarmonics<Dim, double>;
+
+        static constexpr size_t block_size = 64;
+
+        Harmonics(size_t order, Normalization normalization = Normalization::Sn3d)
+        : m_processor(order)
+        , m_weights(m_processor.getNumberOfHarmonics(), 1.)
+        {
+            const long n = long(order);
+            for(long l = 0; l <= n; l++)
+            {
+                for(long m = 0; m <= l; m++)
+                {
+                    if(Dim == Hoa2d && m != l)
+                    {
+                        continue;
+                    }
+
+                    // (l - m)! / (l + m)!
+                    double ratio = 1.;
+                    for(long j = l - m + 1; j <= l + m; j++)
+                    {
+                        ratio /= double(j);
+                    }
+
+                    double norm = (Dim == Hoa2d) ? 1. : std::sqrt((m ? 2. : 1.) * ratio);
+                    if(Dim == Hoa3d && normalization == Normalization::N3d)
+                    {
+                        norm *= std::sqrt(2. * double(l) + 1.);
+                    }
+
+                    m_norms.push_back(norm);
+                    m_cosine_indices.push_back(m_processor.getHarmonicIndex(size_t(l), m));
+                    m_sine_indices.push_back(m ? m_processor.getHarmonicIndex(size_t(l), -m) : 0);
+                }
+            }
+        }
+
+        ~Harmonics() = default;
+
+        inline size_t getDecompositionOrder() const noexcept
+        {
+            return m_processor.getDecompositionOrder();
+        }
+
+        inline size_t getNumberOfHarmonics() const noexcept
+        {
+            return m_processor.getNumberOfHarmonics();
+        }
+
+        //! @brief Sets the weights of the harmonics.
+        void setWeights(std::vector<double> const& weights)
+        {
+            std::copy_n(weights.begin(), std::min(weights.size(), m_weights.size()), m_weights.begin());
+        }
+
+        //! @brief Evaluates the harmonics of the directions.
+        //! @param count The number of directions.
+        //! @param azimuths The azimuths of the directions.
+        //! @param elevations The elevations of the directions (ignored in 2D).
+        //! @param gains The gains of the directions or nullptr.
+        //! @param output The directions x harmonics matrix.
+        void process(size_t count, double const* azimuths, double const* elevations,
+                     double const* gains, double* output) const
+        {
+            const auto order = getDecompositionOrder();
+            const auto number_of_harmonics = getNumberOfHarmonics();
+            const size_t B = block_size;
+
+            std::vector<double> cosines ((order + 1) * B), sines ((order + 1) * B);
+            std::vector<double> x (B), y (B), g (B);
+            std::vector<double> p0 (B), p1 (B), p2 (B), pmm (B);
+            std::vector<double> block (number_of_harmonics * B);
+
+            for(size_t start = 0; start < count; start += B)
+            {
+                const size_t n = std::min(B, count - start);
+
+                for(size_t i = 0; i < n; i++)
+                {
+                    cosines[i] = 1.;
+                    sines[i] = 0.;
+                    cosines[B + i] = std::cos(azimuths[start + i]);
+                    sines[B + i] = std::sin(azimuths[start + i]);
+                    g[i] = gains ? gains[start + i] : 1.;
+                }
+
+                // cos(m.a) and sin(m.a) from cos((m - 1).a) and sin((m - 1).a)
+                for(size_t m = 2; m <= order; m++)
+                {
+                    double* c = cosines.data() + m * B;
+                    double* s = sines.data() + m * B;
+                    double const* pc = c - B;
+                    double const* ps = s - B;
+                    double const* c1 = cosines.data() + B;
+                    double const* s1 = sines.data() + B;
+                    for(size_t i = 0; i < n; i++)
+                    {
+                        c[i] = pc[i] * c1[i] - ps[i] * s1[i];
+                        s[i] = ps[i] * c1[i] + pc[i] * s1[i];
+                    }
+                }
+
+                if constexpr(Dim == Hoa2d)
+                {
+                    for(size_t m = 0; m <= order; m++)
+                    {
+                        emit(m, m, g.data(), n, cosines.data(), sines.data(), block.data());
+                    }
+                }
+                else
+                {
+                    for(size_t i = 0; i < n; i++)
+                    {
+                        x[i] = std::sin(elevations[start + i]);
+                        y[i] = std::sqrt(std::max(0., 1. - x[i] * x[i]));
+                        pmm[i] = g[i];
+                    }
+
+                    // the gains are folded in the Legendre functions
+                    for(size_t m = 0; m <= order; m++)
+                    {
+                        if(m > 0)
+                        {
+                            const double factor = double(2 * m - 1);
+                            for(size_t i = 0; i < n; i++)
+                            {
+                                pmm[i] *= factor * y[i];
+                            }
+                        }
+
+                        // P(m, m)
+                        std::copy_n(pmm.begin(), n, p1.begin());
+                        emit(m, triangle(m, m), p1.data(), n, cosines.data(), sines.data(), block.data());
+
+                        if(m == order)
+                        {
+                            break;
+                        }
+
+                        // P(m + 1, m)
+                        const double factor = double(2 * m + 1);
+                        for(size_t i = 0; i < n; i++)
+                        {
+                            p0[i] = x[i] * factor * pmm[i];
+                        }
+                        emit(m, triangle(m + 1, m), p0.data(), n, cosines.data(), sines.data(), block.data());
+
+                        // P(l, m) = ((2l - 1).x.P(l - 1, m) - (l + m - 1).P(l - 2, m)) / (l - m)
+                        for(size_t l = m + 2; l <= order; l++)
+                        {
+                            std::swap(p2, p1);
+                            std::swap(p1, p0);
+                            const double a = double(2 * l - 1) / double(l - m);
+                            const double b = double(l + m - 1) / double(l - m);
+                            for(size_t i = 0; i < n; i++)
+                            {
+                                p0[i] = a * x[i] * p1[i] - b * p2[i];
+                            }
+                            emit(m, triangle(l, m), p0.data(), n, cosines.data(), sines.data(), block.data());
+                        }
+                    }
+                }
+
+                // transposes the block in the directions x harmonics matrix
+                for(size_t i = 0; i < n; i++)
+                {
+                    double* row = output + (start + i) * number_of_harmonics;
+                    for(size_t k = 0; k < number_of_harmonics; k++)
+                    {
+                        row[k] = block[k * B + i];
+                    }
+                }
+            }
+        }
+
+    private:
+
+        //! @brief Returns the index of the degree l and the order m in the normalizations.
+        static inline size_t triangle(size_t l, size_t m) noexcept
+        {
+            return (Dim == Hoa2d) ? l : (l * (l + 1)) / 2 + m;
+        }
+
+        //! @brief Writes the harmonics of a degree and an order in the block.
+        //! @details In 2D the Legendre functions are replaced by the gains.
+        void emit(size_t m, size_t index, double const* legendre, size_t n,
+                  double const* cosines, double const* sines, double* block) const noexcept
+        {
+            const size_t B = block_size;
+            const auto cosine_index = m_cosine_indices[index];
+            const double cosine_factor = m_norms[index] * m_weights[cosine_index];
+            double const* c = cosines + m * B;
+            double* cosine_output = block + cosine_index * B;
+            for(size_t i = 0; i < n; i++)
+            {
+                cosine_output[i] = cosine_factor * legendre[i] * c[i];
+            }
+
+            if(m > 0)
+            {
+                const auto sine_index = m_sine_indices[index];
+                const double sine_factor = m_norms[index] * m_weights[sine_index];
+                double const* s = sines + m * B;
+                double* sine_output = block + sine_index * B;
+                for(size_t i = 0; i < n; i++)
+                {
+                    sine_output[i] = sine_factor * legendre[i] * s[i];
+                }
+            }
+        }
+
+        const processor_t   m_processor;
+        std::vector<double> m_weights {};
+        std::vector<double> m_norms {};
+        std::vector<size_t> m_cosine_indices {};
+        std::vector<size_t> m_sine_indices {};
+    };
+
+    // ================================================================================ //
+    // Harmonics check
+    // ================================================================================ //
+
+    //! @brief Checks the harmonics against the encoder and compares their costs.
+    //! @details The error is the maximum difference between the harmonics of random
+    //! directions and the ones of the encoder, it must stay at the rounding level.
+    template<Dimension Dim>
+    bool checkHarmonics(std::ostream& stream, size_t count = 4096)
+    {
+        const auto dim_str = (Dim == Hoa2d) ? "2D" : "3D";
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<double> distribution(-HOA_PI, HOA_PI);
+
+        std::vector<double> azimuths (count), elevations (count);
+        for(size_t i = 0; i < count; i++)
+        {
+            azimuths[i] = distribution(generator);
+            elevations[i] = (Dim == Hoa2d) ? 0. : distribution(generator) * 0.5;
+        }
+
+        bool valid = true;
+        for(size_t order = 1; order <= 15; order++)
+        {
+            Harmonics<Dim> harmonics(order);
+            Encoder<Dim, double> encoder(order);
+            const auto number_of_harmonics = harmonics.getNumberOfHarmonics();
+            std::vector<double> batch (count * number_of_harmonics), reference (count * number_of_harmonics);
+
+            const auto start = std::chrono::steady_clock::now();
+            harmonics.process(count, azimuths.data(), elevations.data(), nullptr, batch.data());
+            const auto middle = std::chrono::steady_clock::now();
+
+            const double input = 1.;
+            for(size_t i = 0; i < count; i++)
+            {
+                encoder.setAzimuth(azimuths[i]);
+                if constexpr(Dim == Hoa3d)
+                {
+                    encoder.setElevation(elevations[i]);
+                }
+                encoder.process(&input, reference.data() + i * number_of_harmonics);
+            }
+            const auto end = std::chrono::steady_clock::now();
+
+            double error = 0.;
+            for(size_t i = 0; i < batch.size(); i++)
+            {
+                error = std::max(error, std::abs(batch[i] - reference[i]));
+            }
+
+            valid = valid && (error < 1e-9);
+            const double batch_time = std::chrono::duration<double, std::micro>(middle - start).count();
+            const double encoder_time = std::chrono::duration<double, std::micro>(end - middle).count();
+            stream << "harmonics " << dim_str << " order " << order
+            << " : error " << error
+            << ", batch " << batch_time / double(count) << " us/direction"
+            << ", encoder " << encoder_time / double(count) << " us/direction\n";
+        }
+
+        return valid;
+    }
+}
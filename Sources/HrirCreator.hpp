@@ -15,20 +15,169 @@
 
 namespace hoa::hrir_matrix_creator
 {
+    //! @brief Returns the number of threads of the pool of a run.
+    inline size_t getNumberOfThreads(Config const& config)
+    {
+        return config.number_of_threads ? config.number_of_threads : ThreadPool::getHardwareConcurrency();
+    }
+    
+    template<Dimension Dim>
+    void writeSubject(Subject<Dim>&& subject, ThreadPool& pool)
+    {
+        subject.read();
+        subject.write(pool);
+    }
+    
+    //! @brief Writes every requested order of a subject projected at the highest order.
+    template<Dimension Dim>
+    void writeSubjectOrders(Subject<Dim> const& subject, Config const& config, ThreadPool& pool)
+    {
+        for(auto order : config.orders)
+        {
+            Config order_config = config;
+            order_config.order = order;
+            order_config.classname = config.classname + "_O" + std::to_string(order);
+            subject.withOrder(order_config).write(pool);
+        }
+    }
+    
+    //! @brief Returns the config of the projection of a config, at the highest requested order.
+    inline Config getProjectionConfig(Config const& config)
+    {
+        Config projection_config = config;
+        if(!config.orders.empty())
+        {
+            projection_config.order = *config.orders.rbegin();
+        }
+        return projection_config;
+    }
+    
+    //! @brief Projects the subject once at the highest requested order
+    //! and writes every requested order from this single projection.
     template<Dimension Dim>
-    void writeSubject(Subject<Dim>&& subject)
+    void writeSubjectOrders(Config& config, ThreadPool& pool)
     {
+        Config max_config = getProjectionConfig(config);
+        
+        Subject<Dim> subject(max_config);
         subject.read();
-        subject.writeForCPP();
+        writeSubjectOrders(subject, config, pool);
+    }
+    
+    //! @brief Writes the subjects of several configs measured on the same grid.
+    //! @details The harmonics of the directions are computed with the first subject.
+    //! The blocks of the projections of all the subjects on the grid are computed in a
+    //! single pool while the next subjects are read. All the subjects of the group are
+    //! held in memory until they are written.
+    template<Dimension Dim>
+    void writeSubjectsOnGrid(std::vector<Config*> const& configs, ThreadPool& pool)
+    {
+        typename Subject<Dim>::Grid grid;
+        std::vector<std::unique_ptr<Subject<Dim>>> subjects;
+        std::vector<Subject<Dim>*> subjects_on_grid;
+        for(auto* config : configs)
+        {
+            Config max_config = getProjectionConfig(*config);
+            subjects.emplace_back(std::make_unique<Subject<Dim>>(max_config));
+            if(subjects.back()->readOnGrid(grid))
+            {
+                subjects.back()->pushOnGrid(grid, pool);
+                subjects_on_grid.push_back(subjects.back().get());
+            }
+        }
+        
+        pool.wait();
+        for(auto* subject : subjects_on_grid)
+        {
+            subject->finishOnGrid();
+        }
+        
+        for(size_t i = 0; i < configs.size(); i++)
+        {
+            auto const& subject = *subjects[i];
+            if(!subject.getNumberOfResponses())
+            {
+                continue;
+            }
+            
+            if(configs[i]->orders.empty())
+            {
+                subjects[i]->write(pool);
+            }
+            else
+            {
+                writeSubjectOrders(subject, *configs[i], pool);
+            }
+        }
     }
     
     void writeCppFileForConfig(Config& config);
     void writeCppFileForConfig(Config& config)
     {
+        ThreadPool pool(getNumberOfThreads(config));
+        
+        if(!config.orders.empty())
+        {
+            switch(config.dimension)
+            {
+                case hoa::Hoa2d : { writeSubjectOrders<Hoa2d>(config, pool); break;}
+                case hoa::Hoa3d : { writeSubjectOrders<Hoa3d>(config, pool); break;}
+            }
+            return;
+        }
+        
         switch(config.dimension)
         {
-            case hoa::Hoa2d : { writeSubject<Hoa2d>({config}); break;}
-            case hoa::Hoa3d : { writeSubject<Hoa3d>({config}); break;}
+            case hoa::Hoa2d : { writeSubject<Hoa2d>({config}, pool); break;}
+            case hoa::Hoa3d : { writeSubject<Hoa3d>({config}, pool); break;}
+        }
+    }
+    
+    //! @brief Writes the subjects of several configs.
+    //! @details The configs are grouped by dimension, order and database, the
+    //! subjects of a database are measured on the same grid so the harmonics
+    //! are computed once per group. A single pool, sized with the first config, is
+    //! shared by all the groups.
+    void writeCppFilesForConfigs(std::vector<Config>& configs);
+    void writeCppFilesForConfigs(std::vector<Config>& configs)
+    {
+        if(configs.empty())
+        {
+            return;
+        }
+        
+        ThreadPool pool(getNumberOfThreads(configs.front()));
+        
+        auto isSameGroup = [](Config const& lhs, Config const& rhs) {
+            return (lhs.dimension == rhs.dimension
+                    && getProjectionConfig(lhs).order == getProjectionConfig(rhs).order
+                    && lhs.database_type == rhs.database_type
+                    && lhs.split_by_radius == rhs.split_by_radius);
+        };
+        
+        std::vector<bool> written (configs.size(), false);
+        for(size_t i = 0; i < configs.size(); i++)
+        {
+            if(written[i])
+            {
+                continue;
+            }
+            
+            std::vector<Config*> group;
+            for(size_t j = i; j < configs.size(); j++)
+            {
+                if(!written[j] && isSameGroup(configs[i], configs[j]))
+                {
+                    group.push_back(&configs[j]);
+                    written[j] = true;
+                }
+            }
+            
+            switch(configs[i].dimension)
+            {
+                case hoa::Hoa2d : { writeSubjectsOnGrid<Hoa2d>(group, pool); break;}
+                case hoa::Hoa3d : { writeSubjectsOnGrid<Hoa3d>(group, pool); break;}
+            }
         }
     }
 }
@@ -0,0 +1,245 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // LowRankMatrix
+    // ================================================================================ //
+
+    //! @brief The low rank matrix factorizes a harmonic filter bank into shared basis filters.
+    //! @details The matrix H (responses size x number of harmonics, sample major) is
+    //! approximated by B.M^t where B (responses size x rank) are the basis filters and
+    //! M (number of harmonics x rank) is the harmonic mixing matrix. At runtime the
+    //! harmonics are mixed down to rank channels that are convolved with the basis
+    //! filters, so only rank convolutions are needed instead of one per harmonic.
+    //! The factorization is a truncated SVD computed from the eigen decomposition of
+    //! the harmonic Gram matrix H^t.H, the rank is the smallest one that keeps the
+    //! requested ratio of the energy.
+    class LowRankMatrix
+    {
+    public:
+
+        LowRankMatrix() = default;
+        ~LowRankMatrix() = default;
+
+        //! @brief Factorizes the matrix and keeps the given ratio of its energy.
+        void compute(std::vector<double> const& matrix,
+                     size_t responses_size, size_t number_of_harmonics,
+                     double energy_ratio)
+        {
+            const size_t nh = number_of_harmonics;
+
+            std::vector<double> gram(nh * nh, 0.);
+            for(size_t j = 0; j < responses_size; j++)
+            {
+                const double* row = matrix.data() + j * nh;
+                for(size_t k = 0; k < nh; k++)
+                {
+                    const double value = row[k];
+                    double* gram_row = gram.data() + k * nh;
+                    for(size_t l = 0; l < nh; l++)
+                    {
+                        gram_row[l] += value * row[l];
+                    }
+                }
+            }
+
+            std::vector<double> eigenvalues;
+            std::vector<double> eigenvectors;
+            decompose(gram, nh, eigenvalues, eigenvectors);
+
+            // the energy of the matrix is the sum of the squared singular values.
+            const double energy = std::accumulate(eigenvalues.begin(), eigenvalues.end(), 0.);
+
+            m_errors.assign(nh + 1, 0.);
+            double kept = 0.;
+            m_rank = nh;
+            for(size_t r = 0; r <= nh; r++)
+            {
+                m_errors[r] = energy > 0. ? std::sqrt(std::max(0., 1. - kept / energy)) : 0.;
+                if(m_rank == nh && (energy <= 0. || kept >= energy_ratio * energy))
+                {
+                    m_rank = r;
+                }
+
+                if(r < nh)
+                {
+                    kept += eigenvalues[r];
+                }
+            }
+
+            // a null matrix keeps one (null) basis filter so the tables are never empty.
+            if(m_rank == 0 && nh > 0)
+            {
+                m_rank = 1;
+            }
+
+            m_mixing.assign(nh * m_rank, 0.);
+            for(size_t k = 0; k < nh; k++)
+            {
+                for(size_t r = 0; r < m_rank; r++)
+                {
+                    m_mixing[k * m_rank + r] = eigenvectors[k * nh + r];
+                }
+            }
+
+            m_basis.assign(responses_size * m_rank, 0.);
+            for(size_t j = 0; j < responses_size; j++)
+            {
+                const double* row = matrix.data() + j * nh;
+                for(size_t k = 0; k < nh; k++)
+                {
+                    const double value = row[k];
+                    for(size_t r = 0; r < m_rank; r++)
+                    {
+                        m_basis[j * m_rank + r] += value * m_mixing[k * m_rank + r];
+                    }
+                }
+            }
+        }
+
+        //! @brief Returns the number of basis filters.
+        inline size_t getRank() const noexcept
+        {
+            return m_rank;
+        }
+
+        //! @brief Returns the basis filters (responses size x rank, sample major).
+        inline std::vector<double> const& getBasis() const noexcept
+        {
+            return m_basis;
+        }
+
+        //! @brief Returns the mixing matrix (number of harmonics x rank, harmonic major).
+        inline std::vector<double> const& getMixing() const noexcept
+        {
+            return m_mixing;
+        }
+
+        //! @brief Returns the relative reconstruction error (Frobenius norm) for a rank.
+        inline double getError(size_t rank) const noexcept
+        {
+            return rank < m_errors.size() ? m_errors[rank] : 0.;
+        }
+
+        //! @brief Returns the relative reconstruction errors for all the ranks.
+        inline std::vector<double> const& getErrors() const noexcept
+        {
+            return m_errors;
+        }
+
+    private:
+
+        //! @brief Cyclic Jacobi eigen decomposition of a symmetric matrix.
+        //! @details The eigenvalues are sorted in descending order, the eigenvectors
+        //! are stored column wise (vectors[k * size + r] is the k-th component of the r-th vector).
+        static void decompose(std::vector<double> matrix, size_t size,
+                              std::vector<double>& values, std::vector<double>& vectors)
+        {
+            const size_t n = size;
+            std::vector<double> v(n * n, 0.);
+            for(size_t i = 0; i < n; i++)
+            {
+                v[i * n + i] = 1.;
+            }
+
+            for(size_t sweep = 0; sweep < 64; sweep++)
+            {
+                double off = 0.;
+                double diag = 0.;
+                for(size_t p = 0; p < n; p++)
+                {
+                    diag += matrix[p * n + p] * matrix[p * n + p];
+                    for(size_t q = p + 1; q < n; q++)
+                    {
+                        off += matrix[p * n + q] * matrix[p * n + q];
+                    }
+                }
+
+                if(off <= std::numeric_limits<double>::epsilon() * std::numeric_limits<double>::epsilon() * diag)
+                {
+                    break;
+                }
+
+                for(size_t p = 0; p < n; p++)
+                {
+                    for(size_t q = p + 1; q < n; q++)
+                    {
+                        const double apq = matrix[p * n + q];
+                        if(apq == 0.)
+                        {
+                            continue;
+                        }
+
+                        const double theta = (matrix[q * n + q] - matrix[p * n + p]) / (2. * apq);
+                        const double t = (theta >= 0. ? 1. : -1.) / (std::abs(theta) + std::sqrt(theta * theta + 1.));
+                        const double c = 1. / std::sqrt(t * t + 1.);
+                        const double s = t * c;
+
+                        for(size_t k = 0; k < n; k++)
+                        {
+                            const double akp = matrix[k * n + p];
+                            const double akq = matrix[k * n + q];
+                            matrix[k * n + p] = c * akp - s * akq;
+                            matrix[k * n + q] = s * akp + c * akq;
+                        }
+
+                        for(size_t k = 0; k < n; k++)
+                        {
+                            const double apk = matrix[p * n + k];
+                            const double aqk = matrix[q * n + k];
+                            matrix[p * n + k] = c * apk - s * aqk;
+                            matrix[q * n + k] = s * apk + c * aqk;
+                        }
+
+                        for(size_t k = 0; k < n; k++)
+                        {
+                            const double vkp = v[k * n + p];
+                            const double vkq = v[k * n + q];
+                            v[k * n + p] = c * vkp - s * vkq;
+                            v[k * n + q] = s * vkp + c * vkq;
+                        }
+                    }
+                }
+            }
+
+            std::vector<size_t> indices(n);
+            std::iota(indices.begin(), indices.end(), 0);
+            std::sort(indices.begin(), indices.end(), [&](size_t a, size_t b) {
+                return matrix[a * n + a] > matrix[b * n + b];
+            });
+
+            values.resize(n);
+            vectors.resize(n * n);
+            for(size_t r = 0; r < n; r++)
+            {
+                // the Gram matrix is positive semi-definite, rounding can produce tiny negative values.
+                values[r] = std::max(0., matrix[indices[r] * n + indices[r]]);
+                for(size_t k = 0; k < n; k++)
+                {
+                    vectors[k * n + r] = v[k * n + indices[r]];
+                }
+            }
+        }
+
+        std::vector<double> m_basis {};
+        std::vector<double> m_mixing {};
+        std::vector<double> m_errors {};
+        size_t              m_rank = 0;
+    };
+}
@@ -0,0 +1,162 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // NearField
+    // ================================================================================ //
+
+    //! @brief The near field computes the near-field compensation filters of the harmonics.
+    //! @details The near field of a source at a distance r on the harmonics of degree l is
+    //! described by the reverse Bessel polynomial of degree l. The filter that converts
+    //! the harmonics measured at the distance r to a reference distance is
+    //! H(s) = prod (s - c.q / reference) / (s - c.q / r) where q are the roots of the
+    //! polynomial. The filter is stable, its gain is 1 at high frequencies and it is
+    //! discretized by bilinear transform as biquad sections (b0, b1, b2, a1, a2).
+    class NearField
+    {
+    public:
+
+        using complex_t = std::complex<double>;
+
+        static constexpr size_t section_size = 5;
+
+        //! @brief Returns the number of biquad sections needed by a degree.
+        static inline size_t getNumberOfSections(size_t degree) noexcept
+        {
+            return (degree + 1) / 2;
+        }
+
+        //! @brief Returns the biquad sections of a degree, padded with identity sections.
+        static std::vector<double> getSections(size_t degree, size_t number_of_sections,
+                                               double radius, double reference_radius,
+                                               double samplerate, double speed_of_sound)
+        {
+            std::vector<double> sections;
+            const auto roots = getRoots(degree);
+            const double k = 2. * samplerate;
+
+            for(size_t i = 0; i < roots.size(); i++)
+            {
+                const complex_t zero = roots[i] * (speed_of_sound / reference_radius);
+                const complex_t pole = roots[i] * (speed_of_sound / radius);
+
+                if(std::abs(roots[i].imag()) < 1e-9)
+                {
+                    // first order section : (s - z) / (s - p)
+                    const double a0 = k - pole.real();
+                    sections.insert(sections.end(), {
+                        (k - zero.real()) / a0, (-k - zero.real()) / a0, 0.,
+                        (-k - pole.real()) / a0, 0.
+                    });
+                }
+                else if(roots[i].imag() > 0.)
+                {
+                    // second order section with the conjugated roots : s^2 - 2.re.s + |r|^2
+                    const double zb = -2. * zero.real(), zc = std::norm(zero);
+                    const double pb = -2. * pole.real(), pc = std::norm(pole);
+                    const double a0 = k * k + pb * k + pc;
+                    sections.insert(sections.end(), {
+                        (k * k + zb * k + zc) / a0, 2. * (zc - k * k) / a0, (k * k - zb * k + zc) / a0,
+                        2. * (pc - k * k) / a0, (k * k - pb * k + pc) / a0
+                    });
+                }
+            }
+
+            while(sections.size() < number_of_sections * section_size)
+            {
+                sections.insert(sections.end(), {1., 0., 0., 0., 0.});
+            }
+
+            return sections;
+        }
+
+        //! @brief Returns the roots of the reverse Bessel polynomial of a degree.
+        static std::vector<complex_t> getRoots(size_t degree)
+        {
+            if(degree == 0)
+            {
+                return {};
+            }
+
+            // coefficients from the highest power, a_k = (n + k)! / ((n - k)! k! 2^k) for x^(n - k)
+            const long n = long(degree);
+            std::vector<double> coefficients (degree + 1, 0.);
+            for(long k = 0; k <= n; k++)
+            {
+                coefficients[size_t(k)] = std::exp(std::lgamma(double(n + k + 1)) - std::lgamma(double(n - k + 1))
+                                                   - std::lgamma(double(k + 1))) / std::pow(2., double(k));
+            }
+
+            // Durand-Kerner iterations, the polynomial is monic
+            std::vector<complex_t> roots (degree);
+            const complex_t seed (0.4, 0.9);
+            for(size_t i = 0; i < degree; i++)
+            {
+                roots[i] = std::pow(seed, double(i)) * double(degree);
+            }
+
+            auto evaluate = [&](complex_t x) {
+                complex_t value = coefficients[0];
+                for(size_t i = 1; i < coefficients.size(); i++)
+                {
+                    value = value * x + coefficients[i];
+                }
+                return value;
+            };
+
+            for(size_t iteration = 0; iteration < 500; iteration++)
+            {
+                double change = 0.;
+                for(size_t i = 0; i < degree; i++)
+                {
+                    complex_t denominator = 1.;
+                    for(size_t j = 0; j < degree; j++)
+                    {
+                        if(i != j)
+                        {
+                            denominator *= (roots[i] - roots[j]);
+                        }
+                    }
+
+                    const complex_t delta = evaluate(roots[i]) / denominator;
+                    roots[i] -= delta;
+                    change = std::max(change, std::abs(delta));
+                }
+
+                if(change < 1e-14)
+                {
+                    break;
+                }
+            }
+
+            for(auto& root : roots)
+            {
+                if(std::abs(root.imag()) < 1e-9)
+                {
+                    root = complex_t(root.real(), 0.);
+                }
+            }
+
+            std::sort(roots.begin(), roots.end(), [](complex_t const& a, complex_t const& b) {
+                return a.imag() > b.imag();
+            });
+
+            return roots;
+        }
+    };
+}
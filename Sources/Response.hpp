@@ -12,6 +12,7 @@
 #include "../ThirdParty/LibSndFile/src/sndfile.hh"
 
 #include "Config.hpp"
+#include "Dispatch.hpp"
 #include <type_traits>
 
 namespace hoa::hrir_matrix_creator
@@ -36,34 +37,71 @@ namespace hoa::hrir_matrix_creator
             }
         }
         
+        //! @brief Creates a response from interleaved stereo samples in memory.
+        //! @details The azimuth and the elevation are in radians and the radius in meters.
+        Response(double azimuth, double elevation, double radius,
+                 std::vector<double> values, double samplerate)
+        : System::File("", "", "")
+        , m_values(std::move(values))
+        , m_radius(radius)
+        , m_samplerate(samplerate)
+        , m_azimuth(azimuth)
+        , m_elevation(elevation)
+        , m_valid(true)
+        {}
+        
+        //! @brief Reads the wav file, prints an error if it can't be read.
         void read()
         {
+            if(!load())
+            {
+                std::cerr << "can't load wav file : " << getFullName() << "\n";
+            }
+        }
+        
+        //! @brief Reads the wav file without printing, returns false if it can't be read.
+        bool load()
+        {
+            m_values.clear();
+            
             SndfileHandle file(getFullName());
-            if(file && file.channels() == 2)
+            if(!file || file.channels() != 2)
             {
-                try
-                {
-                    m_values.resize(size_t(file.channels() * file.frames()));
-                }
-                catch(std::exception& e)
-                {
-                    std::cout << e.what();
-                    m_values.clear();
-                    return;
-                }
-                size_t count = (size_t)file.read(m_values.data(), sf_count_t(file.channels() * file.frames()));
-                
-                if(count != m_values.size())
-                {
-                    m_values.clear();
-                    std::cerr << count << "[!] error " << '\n';
-                }
+                return false;
+            }
+            
+            try
+            {
+                m_values.resize(size_t(file.channels() * file.frames()));
+            }
+            catch(std::exception&)
+            {
+                m_values.clear();
+                return false;
+            }
+            
+            size_t count = 0;
+            const auto subformat = file.format() & SF_FORMAT_SUBMASK;
+            if(subformat == SF_FORMAT_PCM_16 || subformat == SF_FORMAT_PCM_24 || subformat == SF_FORMAT_PCM_32)
+            {
+                // the integer samples are left aligned on 32 bits, the conversion is exact.
+                std::vector<int32_t> integers (m_values.size());
+                count = (size_t)file.read(integers.data(), sf_count_t(integers.size()));
+                Dispatch::getKernels().convert(m_values.data(), integers.data(), 1. / 2147483648., count);
             }
             else
+            {
+                count = (size_t)file.read(m_values.data(), sf_count_t(file.channels() * file.frames()));
+            }
+            m_samplerate = double(file.samplerate());
+            
+            if(count != m_values.size())
             {
                 m_values.clear();
-                std::cerr << "can't load wav file : " << getFullName() << "\n";
+                return false;
             }
+            
+            return true;
         }
         
         ~Response() = default;
@@ -73,6 +111,11 @@ namespace hoa::hrir_matrix_creator
             return m_radius;
         }
         
+        double getSamplerate() const
+        {
+            return m_samplerate;
+        }
+        
         double getAzimuth() const
         {
             return m_azimuth;
@@ -137,7 +180,15 @@ namespace hoa::hrir_matrix_creator
             // ex: IRC_1002_C_R0195_T180_P060.wav
             
             std::string name = getName();
-            std::string::size_type pos = name.find("_T");
+            std::string::size_type pos = name.find("_R");
+            
+            // the radius is in centimeters
+            if(pos != std::string::npos && pos < name.size() - 2 && std::isdigit(name[pos+2]))
+            {
+                m_radius = stod(name.substr(pos+2)) / 100.;
+            }
+            
+            pos = name.find("_T");
             
             if(pos != std::string::npos && pos < name.size() - 2)
             {
@@ -161,6 +212,7 @@ namespace hoa::hrir_matrix_creator
         
         std::vector<double> m_values {};
         double              m_radius = 1.;
+        double              m_samplerate = 0.;
         double              m_azimuth = 0.;
         double              m_elevation = 0.;
         size_t              m_size = 0;
@@ -0,0 +1,476 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include "../ThirdParty/HoaLibrary/Sources/Hoa.hpp"
+
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <ostream>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // Rotation
+    // ================================================================================ //
+
+    //! @brief The rotation rotates a sound field in the harmonics domain.
+    //! @details A rotation only mixes the harmonics of the same degree, so the matrix
+    //! is stored and applied as one block per degree. In 2D a block is a 2x2 rotation
+    //! of angle l.yaw whose cosine and sine are computed by recurrence. In 3D the
+    //! blocks are computed from the degree 1 block with the Ivanic & Ruedenberg
+    //! recurrence, without trigonometric function per coefficient.
+    //! The harmonics are processed by blocks of samples (one buffer per harmonic),
+    //! the matrix is linearly interpolated over a block when the rotation changes.
+    //! The inputs and the outputs must not overlap.
+    template<Dimension Dim, typename T>
+    class Rotation
+    {
+    public:
+
+        using processor_t = ProcessorHarmonics<Dim, T>;
+
+        Rotation(size_t order)
+        : m_processor(order)
+        {
+            size_t size = 0;
+            for(size_t l = 0; l <= order; l++)
+            {
+                m_offsets.push_back(size);
+                size += getBlockSize(l) * getBlockSize(l);
+            }
+
+            m_current.assign(size, T(0));
+            for(size_t l = 0; l <= order; l++)
+            {
+                for(size_t i = 0; i < getBlockSize(l); i++)
+                {
+                    m_current[m_offsets[l] + i * getBlockSize(l) + i] = T(1);
+                }
+            }
+            m_target = m_current;
+            m_difference.assign(size, T(0));
+        }
+
+        //! @brief Creates a rotation that matches a generated hoa::hrir struct.
+        template<typename Hrir>
+        static Rotation create()
+        {
+            static_assert(Hrir::dimension == Dim, "the rotation and the hrir must have the same dimension");
+            return Rotation(Hrir::order);
+        }
+
+        ~Rotation() = default;
+
+        inline size_t getDecompositionOrder() const noexcept
+        {
+            return m_processor.getDecompositionOrder();
+        }
+
+        inline size_t getNumberOfHarmonics() const noexcept
+        {
+            return m_processor.getNumberOfHarmonics();
+        }
+
+        //! @brief Sets the rotation of the sound field (around z, then y, then x).
+        //! @details In 2D only the yaw is used. For head tracking, use setHeadOrientation().
+        void setRotation(double yaw, double pitch = 0., double roll = 0.)
+        {
+            computeMatrix(yaw, pitch, roll, false);
+        }
+
+        //! @brief Sets the orientation of the head, the sound field is rotated by the inverse rotation.
+        void setHeadOrientation(double yaw, double pitch = 0., double roll = 0.)
+        {
+            computeMatrix(yaw, pitch, roll, true);
+        }
+
+        //! @brief Returns the coefficient of the current matrix between two harmonics.
+        T getCoefficient(size_t output_harmonic, size_t input_harmonic) const noexcept
+        {
+            const auto l = m_processor.getHarmonicDegree(output_harmonic);
+            if(m_processor.getHarmonicDegree(input_harmonic) != l)
+            {
+                return T(0);
+            }
+
+            return m_target[m_offsets[l] + getBlockIndex(l, m_processor.getHarmonicOrder(output_harmonic)) * getBlockSize(l)
+                            + getBlockIndex(l, m_processor.getHarmonicOrder(input_harmonic))];
+        }
+
+        //! @brief Rotates a block of samples, inputs and outputs have one buffer per harmonic.
+        void process(T const* const* inputs, T* const* outputs, size_t frames)
+        {
+            const bool interpolate = m_changed;
+            if(interpolate)
+            {
+                if(m_ramp.size() != frames)
+                {
+                    m_ramp.resize(frames);
+                    for(size_t f = 0; f < frames; f++)
+                    {
+                        m_ramp[f] = T(f + 1) / T(frames);
+                    }
+                }
+
+                for(size_t i = 0; i < m_target.size(); i++)
+                {
+                    m_difference[i] = m_target[i] - m_current[i];
+                }
+            }
+
+            const auto order = getDecompositionOrder();
+            for(size_t l = 0; l <= order; l++)
+            {
+                const size_t size = getBlockSize(l);
+                T const* block = m_current.data() + m_offsets[l];
+                T const* difference = m_difference.data() + m_offsets[l];
+
+                for(size_t i = 0; i < size; i++)
+                {
+                    T* output = outputs[getHarmonicIndex(l, i)];
+                    std::fill(output, output + frames, T(0));
+
+                    for(size_t j = 0; j < size; j++)
+                    {
+                        T const* input = inputs[getHarmonicIndex(l, j)];
+                        const T a = block[i * size + j];
+                        const T d = interpolate ? difference[i * size + j] : T(0);
+
+                        if(d != T(0))
+                        {
+                            T const* ramp = m_ramp.data();
+                            for(size_t f = 0; f < frames; f++)
+                            {
+                                output[f] += (a + ramp[f] * d) * input[f];
+                            }
+                        }
+                        else if(a != T(0))
+                        {
+                            for(size_t f = 0; f < frames; f++)
+                            {
+                                output[f] += a * input[f];
+                            }
+                        }
+                    }
+                }
+            }
+
+            if(interpolate)
+            {
+                m_current = m_target;
+                m_changed = false;
+            }
+        }
+
+    private:
+
+        static inline size_t getBlockSize(size_t degree) noexcept
+        {
+            return (Dim == Hoa2d) ? (degree ? 2 : 1) : (2 * degree + 1);
+        }
+
+        //! @brief Returns the index of an order in a block (2D: sine then cosine, 3D: -l to l).
+        static inline size_t getBlockIndex(size_t degree, long order) noexcept
+        {
+            if(Dim == Hoa2d)
+            {
+                return (degree && order > 0) ? 1 : 0;
+            }
+            return size_t(order + long(degree));
+        }
+
+        inline size_t getHarmonicIndex(size_t degree, size_t block_index) const noexcept
+        {
+            if(Dim == Hoa2d)
+            {
+                const long order = degree ? (block_index ? long(degree) : -long(degree)) : 0;
+                return m_processor.getHarmonicIndex(degree, order);
+            }
+            return m_processor.getHarmonicIndex(degree, long(block_index) - long(degree));
+        }
+
+        void computeMatrix(double yaw, double pitch, double roll, bool inverse)
+        {
+            if(Dim == Hoa2d)
+            {
+                computeMatrix2d(inverse ? -yaw : yaw);
+            }
+            else
+            {
+                computeMatrix3d(yaw, pitch, roll, inverse);
+            }
+
+            m_changed = true;
+        }
+
+        void computeMatrix2d(double yaw)
+        {
+            // cos(l.yaw) and sin(l.yaw) by successive complex multiplications.
+            const double c1 = std::cos(yaw);
+            const double s1 = std::sin(yaw);
+            double c = c1;
+            double s = s1;
+
+            for(size_t l = 1; l <= getDecompositionOrder(); l++)
+            {
+                // [sin(l.x), cos(l.x)] -> [sin(l.(x + yaw)), cos(l.(x + yaw))]
+                T* block = m_target.data() + m_offsets[l];
+                block[0] = T(c);
+                block[1] = T(s);
+                block[2] = T(-s);
+                block[3] = T(c);
+
+                const double next_c = c * c1 - s * s1;
+                s = s * c1 + c * s1;
+                c = next_c;
+            }
+        }
+
+        void computeMatrix3d(double yaw, double pitch, double roll, bool inverse)
+        {
+            const double cy = std::cos(yaw), sy = std::sin(yaw);
+            const double cp = std::cos(pitch), sp = std::sin(pitch);
+            const double cr = std::cos(roll), sr = std::sin(roll);
+
+            // R = Rz(yaw).Ry(pitch).Rx(roll) in (x, y, z)
+            double r[3][3] = {
+                {cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr},
+                {sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr},
+                {-sp, cp * sr, cp * cr}
+            };
+
+            if(inverse)
+            {
+                for(size_t i = 0; i < 3; i++)
+                {
+                    for(size_t j = i + 1; j < 3; j++)
+                    {
+                        std::swap(r[i][j], r[j][i]);
+                    }
+                }
+            }
+
+            // the harmonics of degree 1 are ordered (y, z, x).
+            const size_t axes[3] = {1, 2, 0};
+            m_r1.assign(9, 0.);
+            for(size_t i = 0; i < 3; i++)
+            {
+                for(size_t j = 0; j < 3; j++)
+                {
+                    m_r1[i * 3 + j] = r[axes[i]][axes[j]];
+                }
+            }
+
+            const auto order = getDecompositionOrder();
+            m_previous = m_r1;
+            if(order >= 1)
+            {
+                std::copy(m_r1.begin(), m_r1.end(), m_target.begin() + long(m_offsets[1]));
+            }
+
+            for(size_t l = 2; l <= order; l++)
+            {
+                const long degree = long(l);
+                const size_t size = 2 * l + 1;
+                m_block.assign(size * size, 0.);
+
+                for(long m = -degree; m <= degree; m++)
+                {
+                    for(long n = -degree; n <= degree; n++)
+                    {
+                        const double d = (m == 0) ? 1. : 0.;
+                        const long am = std::abs(m);
+                        const double denominator = (std::abs(n) == degree)
+                        ? double(2 * degree * (2 * degree - 1))
+                        : double((degree + n) * (degree - n));
+
+                        const double u = std::sqrt(double((degree + m) * (degree - m)) / denominator);
+                        const double v = 0.5 * std::sqrt((1. + d) * double(degree + am - 1) * double(degree + am) / denominator) * (1. - 2. * d);
+                        const double w = -0.5 * std::sqrt(double(degree - am - 1) * double(degree - am) / denominator) * (1. - d);
+
+                        double value = 0.;
+                        if(u != 0.) { value += u * getU(degree, m, n); }
+                        if(v != 0.) { value += v * getV(degree, m, n); }
+                        if(w != 0.) { value += w * getW(degree, m, n); }
+
+                        m_block[size_t(m + degree) * size + size_t(n + degree)] = value;
+                    }
+                }
+
+                std::copy(m_block.begin(), m_block.end(), m_target.begin() + long(m_offsets[l]));
+                m_previous.swap(m_block);
+            }
+        }
+
+        inline double getR1(long i, long j) const noexcept
+        {
+            return m_r1[size_t(i + 1) * 3 + size_t(j + 1)];
+        }
+
+        inline double getPrevious(long degree, long i, long j) const noexcept
+        {
+            const size_t size = size_t(2 * degree - 1);
+            return m_previous[size_t(i + degree - 1) * size + size_t(j + degree - 1)];
+        }
+
+        double getP(long i, long degree, long a, long b) const noexcept
+        {
+            if(b == degree)
+            {
+                return getR1(i, 1) * getPrevious(degree, a, degree - 1) - getR1(i, -1) * getPrevious(degree, a, -degree + 1);
+            }
+            else if(b == -degree)
+            {
+                return getR1(i, 1) * getPrevious(degree, a, -degree + 1) + getR1(i, -1) * getPrevious(degree, a, degree - 1);
+            }
+            return getR1(i, 0) * getPrevious(degree, a, b);
+        }
+
+        double getU(long degree, long m, long n) const noexcept
+        {
+            return getP(0, degree, m, n);
+        }
+
+        double getV(long degree, long m, long n) const noexcept
+        {
+            if(m == 0)
+            {
+                return getP(1, degree, 1, n) + getP(-1, degree, -1, n);
+            }
+            else if(m > 0)
+            {
+                const double d = (m == 1) ? 1. : 0.;
+                return getP(1, degree, m - 1, n) * std::sqrt(1. + d) - getP(-1, degree, -m + 1, n) * (1. - d);
+            }
+
+            const double d = (m == -1) ? 1. : 0.;
+            return getP(1, degree, m + 1, n) * (1. - d) + getP(-1, degree, -m - 1, n) * std::sqrt(1. + d);
+        }
+
+        double getW(long degree, long m, long n) const noexcept
+        {
+            if(m > 0)
+            {
+                return getP(1, degree, m + 1, n) + getP(-1, degree, -m - 1, n);
+            }
+            else if(m < 0)
+            {
+                return getP(1, degree, m - 1, n) - getP(-1, degree, -m + 1, n);
+            }
+            return 0.;
+        }
+
+        const processor_t   m_processor;
+        std::vector<size_t> m_offsets {};
+        std::vector<T>      m_current {};
+        std::vector<T>      m_target {};
+        std::vector<T>      m_difference {};
+        std::vector<T>      m_ramp {};
+        std::vector<double> m_r1 {};
+        std::vector<double> m_previous {};
+        std::vector<double> m_block {};
+        bool                m_changed = false;
+    };
+
+    // ================================================================================ //
+    // Rotation benchmark
+    // ================================================================================ //
+
+    //! @brief Measures the cost of the rotation and checks it against the encoder.
+    //! @details A source encoded then rotated must match the source encoded at the
+    //! rotated direction, the error is the maximum difference between both.
+    //! The rotation changes every block to measure the interpolated path.
+    template<Dimension Dim>
+    void benchmarkRotation(std::ostream& stream, size_t frames = 64, size_t blocks = 2000)
+    {
+        const auto dim_str = (Dim == Hoa2d) ? "2D" : "3D";
+
+        for(size_t order = 1; order <= 7; order++)
+        {
+            Rotation<Dim, float> rotation(order);
+            Encoder<Dim, double> encoder(order);
+            const auto number_of_harmonics = rotation.getNumberOfHarmonics();
+
+            // accuracy
+            const double yaw = 0.7, pitch = (Dim == Hoa2d) ? 0. : 0.3, roll = (Dim == Hoa2d) ? 0. : -0.4;
+            const double azimuth = 0.4, elevation = (Dim == Hoa2d) ? 0. : 0.2;
+            const double input = 1.;
+            std::vector<double> source (number_of_harmonics), expected (number_of_harmonics);
+
+            encoder.setAzimuth(azimuth);
+            if constexpr(Dim == Hoa3d)
+            {
+                encoder.setElevation(elevation);
+            }
+            encoder.process(&input, source.data());
+
+            // the direction of the source rotated by Rz(yaw).Ry(pitch).Rx(roll)
+            double x = std::cos(elevation) * std::cos(azimuth);
+            double y = std::cos(elevation) * std::sin(azimuth);
+            double z = std::sin(elevation);
+            double t = y * std::cos(roll) - z * std::sin(roll);
+            z = y * std::sin(roll) + z * std::cos(roll); y = t;
+            t = x * std::cos(pitch) + z * std::sin(pitch);
+            z = -x * std::sin(pitch) + z * std::cos(pitch); x = t;
+            t = x * std::cos(yaw) - y * std::sin(yaw);
+            y = x * std::sin(yaw) + y * std::cos(yaw); x = t;
+
+            encoder.setAzimuth(std::atan2(y, x));
+            if constexpr(Dim == Hoa3d)
+            {
+                encoder.setElevation(std::asin(std::max(-1., std::min(1., z))));
+            }
+            encoder.process(&input, expected.data());
+
+            rotation.setRotation(yaw, pitch, roll);
+            double error = 0.;
+            for(size_t i = 0; i < number_of_harmonics; i++)
+            {
+                double value = 0.;
+                for(size_t j = 0; j < number_of_harmonics; j++)
+                {
+                    value += double(rotation.getCoefficient(i, j)) * source[j];
+                }
+                error = std::max(error, std::abs(value - expected[i]));
+            }
+
+            // cost
+            std::vector<std::vector<float>> inputs (number_of_harmonics, std::vector<float>(frames));
+            std::vector<std::vector<float>> outputs (number_of_harmonics, std::vector<float>(frames));
+            std::vector<float const*> input_ptrs;
+            std::vector<float*> output_ptrs;
+            std::mt19937 generator(1);
+            std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+            for(size_t i = 0; i < number_of_harmonics; i++)
+            {
+                std::generate(inputs[i].begin(), inputs[i].end(), [&]() { return distribution(generator); });
+                input_ptrs.push_back(inputs[i].data());
+                output_ptrs.push_back(outputs[i].data());
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            for(size_t b = 0; b < blocks; b++)
+            {
+                const double angle = double(b) * 0.001;
+                rotation.setHeadOrientation(angle, angle * 0.5, angle * 0.25);
+                rotation.process(input_ptrs.data(), output_ptrs.data(), frames);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            const double microseconds = std::chrono::duration<double, std::micro>(end - start).count() / double(blocks);
+
+            stream << "rotation " << dim_str << " order " << order << " : "
+            << microseconds << " us per block of " << frames << " samples, error " << error << "\n";
+        }
+    }
+}
@@ -10,11 +10,23 @@
 #pragma once
 
 #include "Response.hpp"
+#include "LowRank.hpp"
+#include "Accumulator.hpp"
+#include "Codec.hpp"
+#include "NearField.hpp"
+#include "Analysis.hpp"
+#include "ThreadPool.hpp"
+#include "Dispatch.hpp"
+#include "Harmonics.hpp"
 
 #include <limits>
-#include <sstream>
-#include <iomanip>
+#include <array>
+#include <map>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <chrono>
 #include <iostream>
 
 namespace hoa::hrir_matrix_creator
@@ -28,14 +40,8 @@ namespace hoa::hrir_matrix_creator
     {
     public:
         
-        enum BinauralSide
-        {
-            Left = 0,
-            Right
-        };
-        
         using processor_t = ProcessorHarmonics<Dim, double>;
-        using encoder_t = Encoder<Dim, double>;
+        using harmonics_t = Harmonics<Dim>;
         
         Subject(Config& config)
         : m_config(config)
@@ -50,9 +56,33 @@ namespace hoa::hrir_matrix_creator
             return m_folder.getName();
         }
         
+        //! @brief Returns the responses read or borrowed by the subject.
+        inline std::vector<Response> const& getResponses() const noexcept
+        {
+            return m_borrowed_responses ? *m_borrowed_responses : m_responses;
+        }
+        
         inline size_t getNumberOfResponses() const noexcept
         {
-            return m_responses.size();
+            return getResponses().size();
+        }
+        
+        //! @brief Returns the number of responses measured at a distance.
+        inline size_t getNumberOfResponses(size_t distance_index) const noexcept
+        {
+            return isSplitByRadius() ? m_distances_counts[distance_index] : getNumberOfResponses();
+        }
+        
+        //! @brief Returns the number of matrices, one per distance if the responses are split by radius.
+        inline size_t getNumberOfDistances() const noexcept
+        {
+            return isSplitByRadius() ? m_distances.size() : 1;
+        }
+        
+        //! @brief Returns the measured distances sorted in ascending order.
+        inline std::vector<double> const& getDistances() const noexcept
+        {
+            return m_distances;
         }
         
         inline size_t getResponsesSize() const noexcept
@@ -77,30 +107,211 @@ namespace hoa::hrir_matrix_creator
         
         void read()
         {
-            responseSetup();
+            readResponses();
+            process();
+            compress();
+        }
+        
+        //! @brief Projects responses loaded in memory.
+        //! @details The responses are borrowed, they must outlive the subject.
+        void read(std::vector<Response> const& responses)
+        {
+            setResponses(responses);
+            allocateMatrices();
+            process();
+            compress();
+        }
+        
+        //! @brief Borrows responses loaded in memory without projecting them.
+        void setResponses(std::vector<Response> const& responses)
+        {
+            m_responses.clear();
+            m_borrowed_responses = &responses;
+            m_size = 0;
+            for(auto const& response : getResponses())
+            {
+                m_size = std::max(m_size, response.getNumberOfSamplesPerChannel());
+            }
             
-            m_left.resize(getMatricesSize());
-            fill(m_left.begin(), m_left.end(), 0.);
-            m_right.resize(getMatricesSize());
-            fill(m_right.begin(), m_right.end(), 0.);
+            distancesSetup();
+        }
+        
+        //! @brief Returns the samplerate shared by all the responses, 0 if they don't share one.
+        inline double getSamplerate() const noexcept
+        {
+            return m_samplerate;
+        }
+        
+        //! @brief Returns the left matrix (responses size x number of harmonics per distance).
+        inline std::vector<double> const& getLeftMatrix() const noexcept
+        {
+            return m_left;
+        }
+        
+        //! @brief Returns the right matrix (responses size x number of harmonics per distance).
+        inline std::vector<double> const& getRightMatrix() const noexcept
+        {
+            return m_right;
+        }
+        
+        //! @brief The harmonics of the directions of a measurement grid shared by several subjects.
+        struct Grid
+        {
+            std::vector<std::array<double, 3>>  directions {};          //! azimuth, elevation, radius
+            std::vector<double>                 harmonics {};           //! directions x harmonics
+            size_t                              number_of_harmonics = 0;
+            bool                                split_by_radius = false;
+        };
+        
+        //! @brief Reads the responses and matches them with the directions of a grid.
+        //! @details The grid is computed from the subject if it is empty. Returns true if the
+        //! subject must be projected with pushOnGrid(). A subject measured on other
+        //! directions, or accumulated in single precision, is projected on its own. A subject
+        //! without responses is left empty and the grid isn't changed.
+        bool readOnGrid(Grid& grid)
+        {
+            readResponses();
+            
+            if(getResponses().empty())
+            {
+                std::cerr << "[!] error - " << getClassName() << " has no responses in " << m_folder.getFullName() << '\n';
+                return false;
+            }
+            
+            if(m_config.accumulation == Accumulation::Double)
+            {
+                if(grid.directions.empty())
+                {
+                    grid = getGrid();
+                }
+                
+                m_grid_indices = getGridIndices(grid);
+                if(!m_grid_indices.empty())
+                {
+                    return true;
+                }
+                
+                std::cout << getClassName() << " : the directions don't match the grid\n";
+            }
             
             process();
+            compress();
+            return false;
         }
         
-        void writeForCPP()
+        //! @brief Pushes the projection of a subject matched with a grid in a pool.
+        //! @details The matrices are the product of the samples (responses x samples) and of
+        //! the harmonics of the grid (responses x harmonics). The product is computed by blocks
+        //! of samples so a block of the matrices stays in cache while all the responses are
+        //! accumulated. The blocks of all the subjects of a grid are pushed in the same pool
+        //! and computed in parallel while the next subjects are read, finishOnGrid() must be
+        //! called once the pool is done. The responses are accumulated in the same order as
+        //! processDouble() so the results are identical.
+        void pushOnGrid(Grid const& grid, ThreadPool& pool)
+        {
+            const auto number_of_harmonics = getNumberOfHarmonics();
+            const auto size = getResponsesSize();
+            const size_t block_size = std::max(size_t(2048) / std::max(number_of_harmonics, size_t(1)), size_t(16));
+            
+            for(size_t start = 0; start < size; start += block_size)
+            {
+                const size_t end = std::min(start + block_size, size);
+                pool.push([this, &grid, start, end]() {
+                    processBlockOnGrid(grid, start, end);
+                });
+            }
+        }
+        
+        //! @brief Completes the projection on a grid, once the blocks pushed by pushOnGrid() are done.
+        void finishOnGrid()
+        {
+            m_grid_indices.clear();
+            applySymmetry();
+            compress();
+        }
+        
+        //! @brief Returns the harmonics of the directions of the responses.
+        Grid getGrid() const
+        {
+            Grid grid;
+            grid.number_of_harmonics = getNumberOfHarmonics();
+            grid.split_by_radius = isSplitByRadius();
+            grid.harmonics = getDirectionsHarmonics();
+            
+            for(auto const& response : getResponses())
+            {
+                grid.directions.push_back({response.getAzimuth(), response.getElevation(), response.getRadius()});
+            }
+            
+            return grid;
+        }
+        
+        //! @brief Returns a copy of the subject reduced to a lower decomposition order.
+        //! @details The harmonics of a lower order are a prefix of the harmonics
+        //! of a higher order, so the matrices are sliced and only rescaled by
+        //! the order dependent normalization applied in process().
+        //! The responses are only borrowed if the analysis is written, to decode the
+        //! sliced matrices against them, the subject must then outlive the returned one.
+        //! Otherwise the returned subject can only be written.
+        Subject withOrder(Config const& config) const
+        {
+            return Subject(*this, config);
+        }
+        
+        //! @brief Returns the class name of the subject with its dimension.
+        std::string getClassName() const
         {
-            const auto filepath_base = m_config.output_directory;
-            const auto filename_prefix = m_config.filename_prefix;;
             const auto dim_str = (Dim == Hoa2d) ? "2D" : "3D";
-            const auto classname = m_config.classname + "_" + dim_str;
-            const auto extension = m_config.file_extension;
-            const auto filename = filepath_base + filename_prefix + classname + extension;
+            return m_config.classname + "_" + dim_str;
+        }
+        
+        //! @brief Returns the path of an output file for an extension.
+        std::string getOutputFileName(std::string const& extension) const
+        {
+            return m_config.output_directory + m_config.filename_prefix + getClassName() + extension;
+        }
+        
+        //! @brief Writes all the output files requested by the config.
+        //! @details Nothing else is written if the header can't be written.
+        //! Returns false if one of the files can't be written.
+        bool write(ThreadPool& pool)
+        {
+            if(!writeForCPP(pool))
+            {
+                return false;
+            }
+            
+            bool valid = true;
+            if(m_config.write_compressed)
+            {
+                valid = writeCompressed() && valid;
+            }
+            
+            if(m_config.write_analysis)
+            {
+                valid = writeAnalysis(pool) && valid;
+            }
+            
+            return valid;
+        }
+        
+        //! @brief Writes the header, it is removed with its shards if a table can't be written.
+        bool writeForCPP(ThreadPool& pool)
+        {
+            const auto classname = getClassName();
+            const auto filename = getOutputFileName(m_config.file_extension);
+            
+            if(isSplitByRadius() && m_samplerate <= 0.)
+            {
+                std::cerr << "[!] error - " << classname << " near field filters need a positive samplerate shared by all the responses\n";
+                return false;
+            }
             
             std::ofstream file(filename);
             if(!file.is_open())
             {
                 std::cerr << "[!] error - can't read " << filename << '\n';
-                return;
+                return false;
             }
             
             // --- write data to file --- //
@@ -130,12 +341,75 @@ namespace hoa::hrir_matrix_creator
             file << tab << tab << "static const size_t number_of_harmonics = " << getNumberOfHarmonics() << ";\n";
             file << tab << tab << "static const size_t responses_size = " << getResponsesSize() << ";\n";
             
+            if(isSplitByRadius())
+            {
+                file << tab << tab << "static const size_t number_of_distances = " << getNumberOfDistances() << ";\n";
+                file << tab << tab << "static const size_t nfc_sections = " << getNumberOfNearFieldSections() << ";\n";
+            }
+            
+            if(isSymmetric())
+            {
+                // the right ear is the left ear multiplied by the sign mask
+                file << tab << tab << "static const bool symmetric = true;\n";
+            }
+            
             file << newline;
             
-            writeData<float, BinauralSide::Left>(file, m_left);
-            writeData<float, BinauralSide::Right>(file, m_right);
-            writeData<double, BinauralSide::Left>(file, m_left);
-            writeData<double, BinauralSide::Right>(file, m_right);
+            bool valid = true;
+            std::vector<std::string> shards;
+            if(isSplitByRadius())
+            {
+                // the matrices are stored distance by distance, the near field compensation
+                // filters are stored [distance][degree][section][b0, b1, b2, a1, a2].
+                valid = valid && writeData<double>(file, "distances", m_distances, pool, shards);
+                valid = valid && writeData<double>(file, "nfc", getNearFieldFilters(), pool, shards);
+            }
+            
+            if(isSymmetric())
+            {
+                valid = valid && writeData<float>(file, "left", m_left, pool, shards);
+                valid = valid && writeData<float>(file, "right_sign_mask", getRightSignMask(), pool, shards);
+                valid = valid && writeData<double>(file, "left", m_left, pool, shards);
+                valid = valid && writeData<double>(file, "right_sign_mask", getRightSignMask(), pool, shards);
+            }
+            else
+            {
+                valid = valid && writeData<float>(file, "left", m_left, pool, shards);
+                valid = valid && writeData<float>(file, "right", m_right, pool, shards);
+                valid = valid && writeData<double>(file, "left", m_left, pool, shards);
+                valid = valid && writeData<double>(file, "right", m_right, pool, shards);
+            }
+            
+            if(isCompressed())
+            {
+                file << tab << tab << "static const size_t left_rank = " << m_left_low_rank.getRank() << ";\n";
+                if(!isSymmetric())
+                {
+                    file << tab << tab << "static const size_t right_rank = " << m_right_low_rank.getRank() << ";\n";
+                }
+                
+                file << newline;
+                
+                valid = valid && writeData<float>(file, "left_basis", m_left_low_rank.getBasis(), pool, shards);
+                valid = valid && writeData<float>(file, "left_mixing", m_left_low_rank.getMixing(), pool, shards);
+                if(!isSymmetric())
+                {
+                    valid = valid && writeData<float>(file, "right_basis", m_right_low_rank.getBasis(), pool, shards);
+                    valid = valid && writeData<float>(file, "right_mixing", m_right_low_rank.getMixing(), pool, shards);
+                }
+            }
+            
+            if(!valid)
+            {
+                file.close();
+                std::remove(filename.c_str());
+                for(auto const& shard : shards)
+                {
+                    std::remove(shard.c_str());
+                }
+                std::cerr << "[!] error - " << classname << " response not written\n";
+                return false;
+            }
             
             file << tab << "};\n\n"; // end of struct
             
@@ -144,11 +418,664 @@ namespace hoa::hrir_matrix_creator
             file.close();
             
             std::cout << classname << " response written" << "\n";
+            return true;
+        }
+        
+        //! @brief Writes the matrices in the compressed binary format.
+        //! @details If the ears are symmetric, only the left tables are written with the sign
+        //! mask of the right ear, like the header.
+        bool writeCompressed()
+        {
+            const auto filename = getOutputFileName(m_config.compressed_extension);
+            
+            codec::CompressedMatrices matrices;
+            matrices.dimension = (Dim == Hoa2d) ? 2 : 3;
+            matrices.order = uint32_t(getDecompositionOrder());
+            matrices.number_of_harmonics = uint32_t(getNumberOfHarmonics());
+            matrices.responses_size = uint32_t(getResponsesSize());
+            
+            if(isSymmetric())
+            {
+                for(auto const& sign : getRightSignMask())
+                {
+                    matrices.right_sign_mask.push_back(int8_t(sign));
+                }
+            }
+            
+            // one left and one right table per distance, only the left one if symmetric
+            for(size_t d = 0; d < getNumberOfDistances(); d++)
+            {
+                const auto begin = long(d * getMatricesSize());
+                const auto end = long((d + 1) * getMatricesSize());
+                matrices.addTable({m_left.begin() + begin, m_left.begin() + end}, m_config.compressed_snr);
+                if(!isSymmetric())
+                {
+                    matrices.addTable({m_right.begin() + begin, m_right.begin() + end}, m_config.compressed_snr);
+                }
+            }
+            
+            std::ofstream file(filename, std::ios::binary);
+            if(!file.is_open())
+            {
+                std::cerr << "[!] error - can't write " << filename << '\n';
+                return false;
+            }
+            
+            matrices.write(file);
+            file.close();
+            if(!file)
+            {
+                std::cerr << "[!] error - can't write " << filename << '\n';
+                return false;
+            }
+            
+            const auto raw_size = matrices.getNumberOfTables() * getMatricesSize() * sizeof(float);
+            std::cout << getClassName() << " compressed response written ("
+            << matrices.getPayloadSize() << " / " << raw_size << " bytes)\n";
+            return true;
+        }
+        
+        //! @brief Writes the analysis report in the analysis file.
+        bool writeAnalysis(ThreadPool& pool)
+        {
+            if(getResponses().empty())
+            {
+                std::cerr << "[!] warning - " << getClassName() << " has no responses to analyse\n";
+                return false;
+            }
+            
+            const auto filename = getOutputFileName("_analysis.txt");
+            std::ofstream file(filename);
+            if(!file.is_open())
+            {
+                std::cerr << "[!] error - can't write " << filename << '\n';
+                return false;
+            }
+            
+            writeAnalysis(file, pool);
+            std::cout << getClassName() << " analysis written" << "\n";
+            return true;
+        }
+        
+        //! @brief Decodes the matrices at every measured direction and writes the errors against the responses.
+        //! @details The harmonics of all the directions are computed once, then the directions
+        //! are decoded and compared in parallel by chunks. Returns false if there is no response.
+        bool writeAnalysis(std::ostream& stream, ThreadPool& pool) const
+        {
+            if(getResponses().empty())
+            {
+                return false;
+            }
+            
+            const auto number_of_harmonics = getNumberOfHarmonics();
+            const auto number_of_responses = getNumberOfResponses();
+            const auto size = getResponsesSize();
+            const Analysis analysis(size, m_samplerate);
+            
+            std::vector<double> harmonics (number_of_responses * number_of_harmonics, 0.);
+            std::vector<double> azimuths, elevations;
+            for(auto const& response : getResponses())
+            {
+                azimuths.push_back(response.getAzimuth());
+                elevations.push_back(response.getElevation());
+            }
+            harmonics_t(getDecompositionOrder()).process(number_of_responses, azimuths.data(), elevations.data(),
+                                                        nullptr, harmonics.data());
+            
+            std::vector<Analysis::Error> errors (number_of_responses);
+            
+            auto analyseResponse = [&](size_t i) {
+                
+                auto const& response = getResponses()[i];
+                std::vector<double> measured (size * 2), reconstructed (size * 2, 0.);
+                double const* direction_harmonics = harmonics.data() + i * number_of_harmonics;
+                double const* left = m_left.data() + getMatrixOffset(response);
+                double const* right = m_right.data() + getMatrixOffset(response);
+                
+                for(size_t j = 0; j < size; j++)
+                {
+                    measured[j] = response.getSample(0, j);
+                    measured[size + j] = response.getSample(1, j);
+                    
+                    double left_sum = 0., right_sum = 0.;
+                    for(size_t k = 0; k < number_of_harmonics; k++)
+                    {
+                        left_sum += left[j * number_of_harmonics + k] * direction_harmonics[k];
+                        right_sum += right[j * number_of_harmonics + k] * direction_harmonics[k];
+                    }
+                    reconstructed[j] = left_sum;
+                    reconstructed[size + j] = right_sum;
+                }
+                
+                errors[i] = analysis.compare(measured.data(), measured.data() + size,
+                                             reconstructed.data(), reconstructed.data() + size);
+                errors[i].azimuth = response.getAzimuth() / HOA_2PI * 360.;
+                errors[i].elevation = response.getElevation() / HOA_2PI * 360.;
+            };
+            
+            const size_t chunk_size = std::max(number_of_responses / (pool.getNumberOfThreads() * 4), size_t(1));
+            for(size_t start = 0; start < number_of_responses; start += chunk_size)
+            {
+                const size_t end = std::min(start + chunk_size, number_of_responses);
+                pool.push([&analyseResponse, start, end]() {
+                    for(size_t i = start; i < end; i++)
+                    {
+                        analyseResponse(i);
+                    }
+                });
+            }
+            pool.wait();
+            
+            analysis.writeReport(stream, getClassName(), errors);
+            return true;
+        }
+        
+        //! @brief Returns the low rank factorization of the left matrix (if low_rank_energy is set).
+        inline LowRankMatrix const& getLeftLowRank() const noexcept
+        {
+            return m_left_low_rank;
+        }
+        
+        //! @brief Returns the low rank factorization of the right matrix (if low_rank_energy is set).
+        inline LowRankMatrix const& getRightLowRank() const noexcept
+        {
+            return m_right_low_rank;
+        }
+        
+        //! @brief Returns the number of biquad sections of the near field filters of each degree.
+        inline size_t getNumberOfNearFieldSections() const noexcept
+        {
+            return std::max(NearField::getNumberOfSections(getDecompositionOrder()), size_t(1));
+        }
+        
+        //! @brief Returns the near field compensation filters from each distance to the reference distance.
+        std::vector<double> getNearFieldFilters() const
+        {
+            const double reference = (m_config.reference_radius > 0.)
+            ? m_config.reference_radius
+            : (m_distances.empty() ? 1. : m_distances.back());
+            
+            std::vector<double> filters;
+            for(auto const& distance : m_distances)
+            {
+                for(size_t l = 0; l <= getDecompositionOrder(); l++)
+                {
+                    const auto sections = NearField::getSections(l, getNumberOfNearFieldSections(), distance, reference,
+                                                                 m_samplerate, m_config.speed_of_sound);
+                    filters.insert(filters.end(), sections.begin(), sections.end());
+                }
+            }
+            return filters;
         }
         
     private: // methods
         
-        void process();
+        Subject(Subject const& other, Config const& config)
+        : m_config(config)
+        , m_processor(std::min(config.order, other.getDecompositionOrder()))
+        , m_folder(config.wave_folder)
+        , m_borrowed_responses(config.write_analysis ? &other.getResponses() : nullptr)
+        , m_size(other.m_size)
+        , m_samplerate(other.m_samplerate)
+        , m_distances(other.m_distances)
+        , m_distances_counts(other.m_distances_counts)
+        {
+            const auto number_of_harmonics = getNumberOfHarmonics();
+            const auto other_number_of_harmonics = other.getNumberOfHarmonics();
+            
+            // the 2D projection is normalized by (order + 1), the 3D one doesn't depend on the order.
+            const double gain = (Dim == Hoa2d)
+            ? double(other.getDecompositionOrder() + 1) / double(getDecompositionOrder() + 1)
+            : 1.;
+            
+            m_left.resize(getMatricesSize() * getNumberOfDistances());
+            m_right.resize(getMatricesSize() * getNumberOfDistances());
+            
+            // the rows of all the distances are contiguous
+            for(size_t j = 0; j < getResponsesSize() * getNumberOfDistances(); j++)
+            {
+                for(size_t k = 0; k < number_of_harmonics; k++)
+                {
+                    m_left[j * number_of_harmonics + k] = other.m_left[j * other_number_of_harmonics + k] * gain;
+                    m_right[j * number_of_harmonics + k] = other.m_right[j * other_number_of_harmonics + k] * gain;
+                }
+            }
+            
+            compress();
+        }
+        
+        //! @brief Reads the responses and allocates the matrices.
+        void readResponses()
+        {
+            m_borrowed_responses = nullptr;
+            responseSetup();
+            distancesSetup();
+            allocateMatrices();
+        }
+        
+        //! @brief Allocates the matrices of all the distances and clears them.
+        void allocateMatrices()
+        {
+            m_left.resize(getMatricesSize() * getNumberOfDistances());
+            fill(m_left.begin(), m_left.end(), 0.);
+            m_right.resize(getMatricesSize() * getNumberOfDistances());
+            fill(m_right.begin(), m_right.end(), 0.);
+        }
+        
+        //! @brief Returns the indices of the directions of the responses in a grid.
+        //! @details The directions are matched by azimuth, elevation and radius,
+        //! an empty vector is returned if the grid doesn't have the same directions.
+        std::vector<size_t> getGridIndices(Grid const& grid) const
+        {
+            if(grid.number_of_harmonics != getNumberOfHarmonics()
+               || grid.split_by_radius != isSplitByRadius()
+               || grid.directions.size() != getResponses().size())
+            {
+                return {};
+            }
+            
+            using key_t = std::array<long long, 3>;
+            auto getKey = [](double azimuth, double elevation, double radius) {
+                return key_t {std::llround(azimuth * 1e6), std::llround(elevation * 1e6), std::llround(radius * 1e6)};
+            };
+            
+            std::map<key_t, size_t> directions;
+            for(size_t i = 0; i < grid.directions.size(); i++)
+            {
+                auto const& direction = grid.directions[i];
+                directions.emplace(getKey(direction[0], direction[1], direction[2]), i);
+            }
+            
+            if(directions.size() != grid.directions.size())
+            {
+                return {};
+            }
+            
+            std::vector<size_t> indices;
+            for(auto const& response : getResponses())
+            {
+                const auto it = directions.find(getKey(response.getAzimuth(), response.getElevation(), response.getRadius()));
+                if(it == directions.end())
+                {
+                    return {};
+                }
+                indices.push_back(it->second);
+            }
+            
+            return indices;
+        }
+        
+        //! @brief Projects a block of samples of the responses with the harmonics of a grid.
+        //! @details The samples of the block are gathered response by response.
+        void processBlockOnGrid(Grid const& grid, size_t start, size_t end)
+        {
+            const auto number_of_harmonics = getNumberOfHarmonics();
+            const bool project_right = isRightProjected();
+            auto const& kernels = Dispatch::getKernels();
+            
+            std::vector<double> left (end - start), right (end - start);
+            for(size_t i = 0; i < getResponses().size(); i++)
+            {
+                auto const& response = getResponses()[i];
+                for(size_t j = start; j < end; j++)
+                {
+                    left[j - start] = response.getSample(0, j);
+                    right[j - start] = response.getSample(1, j);
+                }
+                
+                const auto offset = getMatrixOffset(response) + start * number_of_harmonics;
+                double const* harmonics = grid.harmonics.data() + m_grid_indices[i] * number_of_harmonics;
+                kernels.project(m_left.data() + offset, left.data(), harmonics, end - start, number_of_harmonics);
+                if(project_right)
+                {
+                    kernels.project(m_right.data() + offset, right.data(), harmonics, end - start, number_of_harmonics);
+                }
+            }
+        }
+        
+        inline bool isCompressed() const noexcept
+        {
+            return m_config.low_rank_energy > 0.;
+        }
+        
+        //! @brief Factorizes the matrices in low rank filter banks if required.
+        void compress()
+        {
+            if(!isCompressed())
+            {
+                return;
+            }
+            
+            // the mixing matrix is shared by all the distances, the basis filters are concatenated.
+            const auto rows = getResponsesSize() * getNumberOfDistances();
+            m_left_low_rank.compute(m_left, rows, getNumberOfHarmonics(), m_config.low_rank_energy);
+            m_right_low_rank.compute(m_right, rows, getNumberOfHarmonics(), m_config.low_rank_energy);
+            
+            const auto& left_errors = m_left_low_rank.getErrors();
+            const auto& right_errors = m_right_low_rank.getErrors();
+            
+            if(!m_config.verbose)
+            {
+                return;
+            }
+            
+            std::cout << m_config.classname << " low rank reconstruction error (rank : left / right)\n";
+            for(size_t rank = 1; rank < left_errors.size(); rank++)
+            {
+                std::cout << "    " << rank << " : " << left_errors[rank] << " / " << right_errors[rank] << "\n";
+            }
+            std::cout << "    selected rank : " << m_left_low_rank.getRank() << " / " << m_right_low_rank.getRank() << "\n";
+        }
+        
+        inline bool isSplitByRadius() const noexcept
+        {
+            return m_config.split_by_radius;
+        }
+        
+        //! @brief Collects the measured distances and the number of responses per distance.
+        void distancesSetup()
+        {
+            m_distances.clear();
+            m_distances_counts.clear();
+            m_samplerate = getResponses().empty() ? 0. : getResponses().front().getSamplerate();
+            
+            for(auto const& response : getResponses())
+            {
+                m_distances.push_back(response.getRadius());
+                
+                // the samplerate is only valid if all the responses share it
+                if(m_samplerate > 0. && response.getSamplerate() != m_samplerate)
+                {
+                    if(m_config.verbose)
+                    {
+                        std::cerr << "[!] error - " << getClassName() << " responses have different samplerates\n";
+                    }
+                    m_samplerate = 0.;
+                }
+            }
+            
+            std::sort(m_distances.begin(), m_distances.end());
+            m_distances.erase(std::unique(m_distances.begin(), m_distances.end()), m_distances.end());
+            
+            m_distances_counts.assign(m_distances.size(), 0);
+            for(auto const& response : getResponses())
+            {
+                ++m_distances_counts[getDistanceIndex(response)];
+            }
+            
+            if(isSplitByRadius() && m_config.verbose)
+            {
+                std::cout << getClassName() << " : " << m_distances.size() << " distances\n";
+            }
+        }
+        
+        //! @brief Returns the index of the distance of a response (always 0 if not split by radius).
+        inline size_t getDistanceIndex(Response const& response) const noexcept
+        {
+            if(!isSplitByRadius())
+            {
+                return 0;
+            }
+            
+            const auto it = std::lower_bound(m_distances.begin(), m_distances.end(), response.getRadius());
+            return size_t(std::distance(m_distances.begin(), it));
+        }
+        
+        //! @brief Returns the offset of the matrix of a response in the matrices.
+        inline size_t getMatrixOffset(Response const& response) const noexcept
+        {
+            return getDistanceIndex(response) * getMatricesSize();
+        }
+        
+        //! @brief Projects the responses on the harmonics with the selected accumulation.
+        void process()
+        {
+            if(m_config.accumulation == Accumulation::Double)
+            {
+                processDouble();
+            }
+            else
+            {
+                processCompensatedFloat();
+                
+                if(m_config.check_accumulation)
+                {
+                    checkAccumulation();
+                }
+            }
+            
+            applySymmetry();
+        }
+        
+        inline bool isSymmetric() const noexcept
+        {
+            return m_config.symmetry != Symmetry::None;
+        }
+        
+        //! @brief Returns false if the right ear is only derived from the left ear.
+        inline bool isRightProjected() const noexcept
+        {
+            return m_config.symmetry != Symmetry::MirrorLeft;
+        }
+        
+        //! @brief Returns the signs that mirror the harmonics across the median plane.
+        //! @details Mirroring a direction negates its azimuth, so the harmonics of
+        //! negative orders (the sine terms) change their signs.
+        std::vector<double> getRightSignMask() const
+        {
+            std::vector<double> mask (getNumberOfHarmonics(), 1.);
+            for(size_t k = 0; k < mask.size(); k++)
+            {
+                mask[k] = (m_processor.getHarmonicOrder(k) < 0) ? -1. : 1.;
+            }
+            return mask;
+        }
+        
+        //! @brief Derives the right matrices from the left ones if the ears are symmetric.
+        void applySymmetry()
+        {
+            if(!isSymmetric())
+            {
+                return;
+            }
+            
+            if(m_config.verbose)
+            {
+                reportAsymmetry();
+            }
+            
+            const auto mask = getRightSignMask();
+            const auto number_of_harmonics = mask.size();
+            
+            for(size_t i = 0; i < m_left.size(); i++)
+            {
+                const double sign = mask[i % number_of_harmonics];
+                if(m_config.symmetry == Symmetry::AverageMirrored)
+                {
+                    m_left[i] = (m_left[i] + sign * m_right[i]) * 0.5;
+                }
+                m_right[i] = sign * m_left[i];
+            }
+        }
+        
+        //! @brief Reports the difference between the left responses and the mirrored right responses.
+        //! @details The responses are paired with the responses of the opposite azimuth,
+        //! the asymmetry is the energy of the differences relative to the energy of the left
+        //! responses. The symmetric mode is safe when it is well below the projection error.
+        void reportAsymmetry() const
+        {
+            using key_t = std::array<long long, 3>;
+            auto getKey = [](double azimuth, double elevation, double radius) {
+                const double wrapped = std::fmod(std::fmod(azimuth, HOA_2PI) + HOA_2PI, HOA_2PI);
+                return key_t {std::llround(wrapped * 1e6) % std::llround(HOA_2PI * 1e6),
+                    std::llround(elevation * 1e6), std::llround(radius * 1e6)};
+            };
+            
+            std::map<key_t, size_t> directions;
+            for(size_t i = 0; i < getResponses().size(); i++)
+            {
+                auto const& response = getResponses()[i];
+                directions.emplace(getKey(response.getAzimuth(), response.getElevation(), response.getRadius()), i);
+            }
+            
+            double difference = 0., energy = 0.;
+            size_t pairs = 0;
+            for(auto const& response : getResponses())
+            {
+                const auto it = directions.find(getKey(-response.getAzimuth(), response.getElevation(), response.getRadius()));
+                if(it == directions.end())
+                {
+                    continue;
+                }
+                
+                auto const& mirrored = getResponses()[it->second];
+                for(size_t j = 0; j < getResponsesSize(); j++)
+                {
+                    const double left = response.getSample(0, j);
+                    const double right = mirrored.getSample(1, j);
+                    difference += (left - right) * (left - right);
+                    energy += left * left;
+                }
+                ++pairs;
+            }
+            
+            if(pairs == 0 || energy <= 0.)
+            {
+                std::cerr << "[!] warning - " << m_config.classname << " has no mirrored responses, the asymmetry can't be measured\n";
+                return;
+            }
+            
+            std::cout << m_config.classname << " ear asymmetry : " << 10. * std::log10(std::max(difference / energy, 1e-30))
+            << " dB (" << pairs << " mirrored responses)\n";
+        }
+        
+        //! @brief Projects the responses with a double precision accumulation.
+        //! @details The harmonics of all the directions are computed at once and the outer
+        //! product of the samples and the harmonics is accumulated by the dispatched kernel.
+        void processDouble()
+        {
+            const auto number_of_harmonics = getNumberOfHarmonics();
+            const auto size = getResponsesSize();
+            const auto harmonics_matrix = getDirectionsHarmonics();
+            std::vector<double> left (size, 0.), right (size, 0.);
+            auto const& kernels = Dispatch::getKernels();
+            
+            for(size_t i = 0; i < getResponses().size(); i++)
+            {
+                auto const& response = getResponses()[i];
+                double const* harmonics = harmonics_matrix.data() + i * number_of_harmonics;
+                for(size_t j = 0; j < size; j++)
+                {
+                    left[j] = response.getSample(0, j);
+                    right[j] = response.getSample(1, j);
+                }
+                
+                const auto offset = getMatrixOffset(response);
+                kernels.project(m_left.data() + offset, left.data(), harmonics, size, number_of_harmonics);
+                if(isRightProjected())
+                {
+                    kernels.project(m_right.data() + offset, right.data(), harmonics, size, number_of_harmonics);
+                }
+            }
+        }
+        
+        //! @brief Projects the responses with a compensated single precision accumulation.
+        //! @details The harmonics of a direction don't depend on the sample, they are
+        //! computed once per response and each sample only scales and accumulates them.
+        void processCompensatedFloat()
+        {
+            const auto number_of_harmonics = getNumberOfHarmonics();
+            const auto harmonics = getDirectionsHarmonics();
+            std::vector<float> harmonics_float (number_of_harmonics, 0.f);
+            
+            CompensatedAccumulator left(m_left.size());
+            CompensatedAccumulator right(m_right.size());
+            
+            for(size_t i = 0; i < getResponses().size(); i++)
+            {
+                auto const& response = getResponses()[i];
+                auto const first = harmonics.begin() + long(i * number_of_harmonics);
+                std::copy(first, first + long(number_of_harmonics), harmonics_float.begin());
+                
+                const auto offset = getMatrixOffset(response);
+                for(size_t j = 0; j < getResponsesSize(); j++)
+                {
+                    const auto index = offset + j * number_of_harmonics;
+                    left.add(index, number_of_harmonics, float(response.getSample(0, j)), harmonics_float.data());
+                    if(isRightProjected())
+                    {
+                        right.add(index, number_of_harmonics, float(response.getSample(1, j)), harmonics_float.data());
+                    }
+                }
+            }
+            
+            left.get(m_left);
+            right.get(m_right);
+        }
+        
+        //! @brief Compares the single precision matrices with the double precision ones.
+        //! @details The double precision matrices are kept if the error exceeds the tolerance.
+        void checkAccumulation()
+        {
+            const auto left = m_left;
+            const auto right = m_right;
+            
+            fill(m_left.begin(), m_left.end(), 0.);
+            fill(m_right.begin(), m_right.end(), 0.);
+            processDouble();
+            
+            double peak = 0.;
+            double error = 0.;
+            for(size_t i = 0; i < m_left.size(); i++)
+            {
+                peak = std::max(peak, std::max(std::abs(m_left[i]), std::abs(m_right[i])));
+                error = std::max(error, std::max(std::abs(m_left[i] - left[i]), std::abs(m_right[i] - right[i])));
+            }
+            
+            const double relative_error = peak > 0. ? error / peak : error;
+            if(m_config.verbose)
+            {
+                std::cout << m_config.classname << " float accumulation error : " << relative_error << "\n";
+            }
+            
+            if(relative_error > m_config.accumulation_tolerance)
+            {
+                if(m_config.verbose)
+                {
+                    std::cerr << "[!] warning - " << m_config.classname
+                    << " float accumulation exceeds the tolerance, the double accumulation is used\n";
+                }
+                return;
+            }
+            
+            m_left = left;
+            m_right = right;
+        }
+        
+        //! @brief Computes the weighted harmonics of the directions of the responses (responses x harmonics).
+        std::vector<double> getDirectionsHarmonics() const
+        {
+            std::vector<double> azimuths, elevations, gains;
+            for(auto const& response : getResponses())
+            {
+                azimuths.push_back(response.getAzimuth());
+                elevations.push_back(response.getElevation());
+                gains.push_back(getProjectionGain(response));
+            }
+            
+            harmonics_t harmonics(getDecompositionOrder());
+            harmonics.setWeights(getProjectionWeights());
+            
+            std::vector<double> matrix (getResponses().size() * getNumberOfHarmonics(), 0.);
+            harmonics.process(getResponses().size(), azimuths.data(), elevations.data(), gains.data(), matrix.data());
+            return matrix;
+        }
+        
+        //! @brief Returns the gain of the projection of a response.
+        double getProjectionGain(Response const& response) const;
+        
+        //! @brief Returns the weights of the projection of the harmonics.
+        std::vector<double> getProjectionWeights() const;
         
         static char const* const get_cpp_file_header_text()
         {
@@ -210,55 +1137,141 @@ namespace hoa::hrir_matrix_creator
             }
         }
         
+        //! @brief Appends the values of a table to a buffer, separated by commas.
+        //! @details The values are formatted with the shortest precision that round-trips,
+        //! the last value of the table isn't followed by a comma.
         template<typename FloatType>
-        std::string convertFloatingPointNumberToString(FloatType value)
+        static void formatValues(double const* values, size_t size, bool last, std::string& output)
         {
             constexpr bool is_float = std::is_same<FloatType, float>::value;
+            constexpr int precision = std::numeric_limits<FloatType>::max_digits10;
             
-            if(value == static_cast<FloatType>(0))
-            {
-                return is_float ? "0.f" : "0.";
-            }
+            char buffer[32];
+            output.reserve(output.size() + size * (precision + 8));
             
-            std::stringstream ss;
-            ss << std::setprecision(std::numeric_limits<FloatType>::max_digits10);
-            ss << value;
-            
-            if constexpr (is_float)
+            for(size_t i = 0; i < size; i++)
             {
-                ss << 'f';
+                const auto value = static_cast<FloatType>(values[i]);
+                if(value == static_cast<FloatType>(0))
+                {
+                    output += is_float ? "0.f" : "0.";
+                }
+                else
+                {
+                    const int length = std::snprintf(buffer, sizeof(buffer), "%.*g", precision, double(value));
+                    output.append(buffer, size_t(length));
+                    if constexpr (is_float)
+                    {
+                        // an integral value needs a decimal point to be a float literal ("1.f")
+                        if(!std::strpbrk(buffer, ".e"))
+                        {
+                            output += '.';
+                        }
+                        output += 'f';
+                    }
+                }
+                
+                // don't add comma for the last value
+                if(!last || i < size - 1)
+                {
+                    output += ", ";
+                }
             }
-            
-            return ss.str();
         }
         
-        template<typename FloatType, BinauralSide Side>
-        void writeData(std::ofstream& file, std::vector<double>& data)
+        //! @brief Writes a table accessor.
+        //! @details The table is split in chunks formatted in parallel and written in order.
+        //! If a shard size is set, each chunk of a larger table is written in its own .inc
+        //! file included in the initializer, so the compilers can process them in parallel.
+        //! The paths of the shards created are appended to shards, even if they can't be
+        //! completed, so they can be removed with the header. Returns false if the table is empty or if a
+        //! shard can't be written, the table is then left incomplete.
+        template<typename FloatType>
+        bool writeData(std::ofstream& file, std::string const& name, std::vector<double> const& data,
+                       ThreadPool& pool, std::vector<std::string>& shards)
         {
-            file.precision(std::numeric_limits<FloatType>::digits10);
-            
             const auto float_type_str = std::is_same<FloatType, float>::value ? "float" : "double";
-            const auto side_str = Side == BinauralSide::Left ? "left" : "right";
+            
+            // an empty initializer isn't valid for an array of unknown bound
+            if(data.empty())
+            {
+                std::cerr << "[!] error - " << getClassName() << " " << name << " table is empty\n";
+                return false;
+            }
             
             const auto tab = "    ";
             
-            file << tab << tab << "static " << float_type_str << " const* get_" << float_type_str << "_" << side_str << "()\n";
+            file << tab << tab << "static " << float_type_str << " const* get_" << float_type_str << "_" << name << "()\n";
             file << tab << tab << "{\n";
             
             file << tab << tab << tab << "static const " << float_type_str << " data[] = {";
             
-            auto* f = data.data();
-            for(size_t i = 0; i < data.size(); ++f, ++i)
+            const bool sharded = (m_config.shard_size > 0 && data.size() > m_config.shard_size);
+            const size_t chunk_size = sharded ? m_config.shard_size : size_t(16384);
+            const size_t number_of_chunks = (data.size() + chunk_size - 1) / chunk_size;
+            std::vector<std::string> chunks (number_of_chunks);
+            
+            auto formatChunk = [&data, &chunks, chunk_size, number_of_chunks](size_t c) {
+                const size_t start = c * chunk_size;
+                const size_t size = std::min(chunk_size, data.size() - start);
+                formatValues<FloatType>(data.data() + start, size, c == number_of_chunks - 1, chunks[c]);
+            };
+            
+            if(number_of_chunks > 1)
             {
-                // don't add comma for the last value
-                const auto separator = (i < data.size() - 1) ? ", " : "";
-                file << convertFloatingPointNumberToString(static_cast<FloatType>(*f)) << separator;
+                for(size_t c = 0; c < number_of_chunks; c++)
+                {
+                    pool.push([&formatChunk, c]() {
+                        formatChunk(c);
+                    });
+                }
+                pool.wait();
+            }
+            else
+            {
+                formatChunk(0);
+            }
+            
+            if(sharded)
+            {
+                file << "\n";
+                for(size_t c = 0; c < number_of_chunks; c++)
+                {
+                    const auto shard_name = m_config.filename_prefix + getClassName() + "_" + float_type_str
+                    + "_" + name + "_" + std::to_string(c) + ".inc";
+                    
+                    const auto shard_path = m_config.output_directory + shard_name;
+                    std::ofstream shard(shard_path);
+                    if(shard.is_open())
+                    {
+                        shards.push_back(shard_path);
+                    }
+                    
+                    shard.write(chunks[c].data(), std::streamsize(chunks[c].size()));
+                    shard << "\n";
+                    if(!shard)
+                    {
+                        std::cerr << "[!] error - can't write " << shard_name << '\n';
+                        return false;
+                    }
+                    
+                    file << "#include \"" << shard_name << "\"\n";
+                }
+                file << tab << tab << tab;
+            }
+            else
+            {
+                for(auto const& chunk : chunks)
+                {
+                    file.write(chunk.data(), std::streamsize(chunk.size()));
+                }
             }
             
             file << "};\n\n";
             
             file << tab << tab << tab << "return data;\n";
             file << tab << tab << "}\n\n";
+            return true;
         }
         
     private: // variables
@@ -267,87 +1280,119 @@ namespace hoa::hrir_matrix_creator
         const processor_t       m_processor;
         const System::Folder    m_folder;
         std::vector<Response>   m_responses = {};
+        std::vector<Response> const* m_borrowed_responses = nullptr;
+        std::vector<size_t>     m_grid_indices = {};
         size_t                  m_size = 0;
+        double                  m_samplerate = 0.;
+        std::vector<double>     m_distances = {};
+        std::vector<size_t>     m_distances_counts = {};
         std::vector<double>     m_left = {};
         std::vector<double>     m_right = {};
+        LowRankMatrix           m_left_low_rank = {};
+        LowRankMatrix           m_right_low_rank = {};
     };
     
     // ================================================================================ //
-    // Subject 2D read
+    // Subject 2D projection
     // ================================================================================ //
     
     template<>
-    void Subject<Hoa2d>::process()
+    double Subject<Hoa2d>::getProjectionGain(Response const&) const
     {
-        std::vector<double> harmonics (getNumberOfHarmonics(), 0.);
-        const auto order = getDecompositionOrder();
-        encoder_t encoder(order);
-        
-        auto processSample = [&] (double input_sample, double* output_buffer) {
-            
-            encoder.process(&input_sample, harmonics.data());
-            harmonics[0] *= 0.5;
-            Signal<double>::add(harmonics.size(), harmonics.data(), output_buffer);
-        };
-        
-        for(auto& response : m_responses)
+        return 1. / double(getDecompositionOrder() + 1.);
+    }
+    
+    template<>
+    std::vector<double> Subject<Hoa2d>::getProjectionWeights() const
+    {
+        std::vector<double> weights (getNumberOfHarmonics(), 1.);
+        weights[0] = 0.5;
+        return weights;
+    }
+    
+    // ================================================================================ //
+    // Subject 3D projection
+    // ================================================================================ //
+    
+    template<>
+    double Subject<Hoa3d>::getProjectionGain(Response const& response) const
+    {
+        return 1. / double(getNumberOfResponses(getDistanceIndex(response)));
+    }
+    
+    template<>
+    std::vector<double> Subject<Hoa3d>::getProjectionWeights() const
+    {
+        std::vector<double> weights (getNumberOfHarmonics(), 1.);
+        for(size_t k = 0; k < weights.size(); k++)
         {
-            encoder.setAzimuth(response.getAzimuth());
-            
-            for(size_t j = 0; j < getResponsesSize(); j++)
-            {
-                const auto index = j * harmonics.size();
-                
-                const double left = response.getSample(0, j) / double(order + 1.);
-                processSample(left, m_left.data() + index);
-                
-                const double right = response.getSample(1, j) / double(order + 1.);
-                processSample(right, m_right.data() + index);
-            }
+            weights[k] = double(2. * m_processor.getHarmonicDegree(k) + 1.);
         }
+        return weights;
     }
     
     // ================================================================================ //
-    // Subject 3D read
+    // Accumulation check
     // ================================================================================ //
     
-    template<>
-    void Subject<Hoa3d>::process()
+    //! @brief Checks the compensated float accumulation against the double accumulation.
+    //! @details Random responses measured on a regular grid are projected with both
+    //! accumulations, the error relative to the peak of the matrices must stay below
+    //! the default tolerance of the config.
+    template<Dimension Dim>
+    bool checkAccumulation(std::ostream& stream, size_t order, size_t responses_size = 512)
     {
-        std::vector<double> harmonics (getNumberOfHarmonics(), 0.);
-        const auto order = getDecompositionOrder();
-        encoder_t encoder(order);
+        const auto dim_str = (Dim == Hoa2d) ? "2D" : "3D";
+        std::mt19937 generator(1);
+        std::normal_distribution<double> distribution;
         
-        auto processSample = [&] (double input_sample, double* output_buffer) {
-            
-            encoder.process(&input_sample, harmonics.data());
-            
-            for(size_t k = 0; k < harmonics.size(); k++)
+        std::vector<Response> responses;
+        for(int elevation = (Dim == Hoa2d) ? 0 : -45; elevation <= ((Dim == Hoa2d) ? 0 : 90); elevation += 45)
+        {
+            for(int azimuth = 0; azimuth < 360; azimuth += 15)
             {
-                const size_t l = encoder.getHarmonicDegree(k);
-                harmonics[k] *= double(2. * l + 1.);
+                std::vector<double> values (responses_size * 2);
+                for(size_t j = 0; j < values.size(); j++)
+                {
+                    values[j] = distribution(generator) * std::exp(-double(j / 2) / double(responses_size / 8));
+                }
+                responses.emplace_back(double(azimuth) / 360. * HOA_2PI, double(elevation) / 360. * HOA_2PI, 1.,
+                                       std::move(values), 44100.);
             }
-            
-            Signal<double>::add(harmonics.size(), harmonics.data(), output_buffer);
-        };
+        }
         
-        const double number_of_responses = getNumberOfResponses();
+        Config config {};
+        config.dimension = Dim;
+        config.order = order;
         
-        for(auto const& response : m_responses)
-        {
-            encoder.setAzimuth(response.getAzimuth());
-            encoder.setElevation(response.getElevation());
-            
-            for(size_t j = 0; j < getResponsesSize(); j++)
+        Subject<Dim> reference(config);
+        const auto start = std::chrono::steady_clock::now();
+        reference.read(responses);
+        const auto middle = std::chrono::steady_clock::now();
+        
+        config.accumulation = Accumulation::CompensatedFloat;
+        Subject<Dim> compensated(config);
+        compensated.read(responses);
+        const auto end = std::chrono::steady_clock::now();
+        
+        double peak = 0.;
+        double error = 0.;
+        auto compare = [&peak, &error](std::vector<double> const& lhs, std::vector<double> const& rhs) {
+            for(size_t i = 0; i < lhs.size(); i++)
             {
-                const auto index = j * harmonics.size();
-                
-                const double left = response.getSample(0, j) / number_of_responses;
-                processSample(left, m_left.data() + index);
-                
-                const double right = response.getSample(1, j) / number_of_responses;
-                processSample(right, m_right.data() + index);
+                peak = std::max(peak, std::abs(lhs[i]));
+                error = std::max(error, std::abs(lhs[i] - rhs[i]));
             }
-        }
+        };
+        compare(reference.getLeftMatrix(), compensated.getLeftMatrix());
+        compare(reference.getRightMatrix(), compensated.getRightMatrix());
+        
+        const double relative_error = peak > 0. ? error / peak : error;
+        const bool valid = relative_error <= config.accumulation_tolerance;
+        stream << "accumulation " << dim_str << " order " << order
+        << " : error " << relative_error << " (tolerance " << config.accumulation_tolerance << ")"
+        << ", double " << std::chrono::duration<double, std::milli>(middle - start).count() << " ms"
+        << ", float " << std::chrono::duration<double, std::milli>(end - middle).count() << " ms\n";
+        return valid;
     }
 }
@@ -0,0 +1,181 @@
+// Copyright (c) 2012-2019 CICM - Universite Paris 8 - Labex Arts H2H.
+// Authors :
+// 2012: Pierre Guillot, Eliott Paris & Julien Colafrancesco.
+// 2012-2015: Pierre Guillot & Eliott Paris.
+// 2015: Pierre Guillot & Eliott Paris & Thomas Le Meur (Light version)
+// 2016-2017: Pierre Guillot.
+// For information on usage and redistribution, and for a DISCLAIMER OF ALL
+// WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+namespace hoa::hrir_matrix_creator
+{
+    // ================================================================================ //
+    // ThreadPool
+    // ================================================================================ //
+
+    //! @brief A work-stealing thread pool.
+    //! @details Each worker owns a queue, the tasks are distributed in round robin.
+    //! A worker takes its own tasks from the back of its queue and, when it is empty,
+    //! steals the tasks from the front of the other queues.
+    class ThreadPool
+    {
+    public:
+
+        using task_t = std::function<void()>;
+
+        ThreadPool(size_t number_of_threads)
+        {
+            number_of_threads = std::max(number_of_threads, size_t(1));
+            for(size_t i = 0; i < number_of_threads; i++)
+            {
+                m_queues.emplace_back(std::make_unique<Queue>());
+            }
+
+            for(size_t i = 0; i < number_of_threads; i++)
+            {
+                m_threads.emplace_back([this, i]() { run(i); });
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+
+            m_condition.notify_all();
+            for(auto& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        //! @brief Returns the number of hardware threads or 1 if unknown.
+        static size_t getHardwareConcurrency() noexcept
+        {
+            return std::max(size_t(std::thread::hardware_concurrency()), size_t(1));
+        }
+
+        inline size_t getNumberOfThreads() const noexcept
+        {
+            return m_threads.size();
+        }
+
+        void push(task_t task)
+        {
+            // the counters are incremented first so a worker never decrements them before.
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_queued;
+                ++m_pending;
+            }
+
+            auto& queue = *m_queues[m_next++ % m_queues.size()];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.emplace_back(std::move(task));
+            }
+
+            m_condition.notify_one();
+        }
+
+        //! @brief Blocks until all the pushed tasks are done.
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done_condition.wait(lock, [this]() { return m_pending == 0; });
+        }
+
+    private:
+
+        struct Queue
+        {
+            std::mutex          mutex;
+            std::deque<task_t>  tasks;
+        };
+
+        bool pop(size_t index, task_t& task)
+        {
+            auto& queue = *m_queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if(queue.tasks.empty())
+            {
+                return false;
+            }
+
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+
+        bool steal(size_t index, task_t& task)
+        {
+            for(size_t i = 1; i < m_queues.size(); i++)
+            {
+                auto& queue = *m_queues[(index + i) % m_queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if(!queue.tasks.empty())
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void run(size_t index)
+        {
+            while(true)
+            {
+                task_t task;
+                if(pop(index, task) || steal(index, task))
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        --m_queued;
+                    }
+
+                    task();
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if(--m_pending == 0)
+                    {
+                        m_done_condition.notify_all();
+                    }
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || m_queued > 0; });
+                if(m_stop && m_queued == 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>> m_queues {};
+        std::vector<std::thread>            m_threads {};
+        std::mutex                          m_mutex {};
+        std::condition_variable             m_condition {};
+        std::condition_variable             m_done_condition {};
+        std::atomic<size_t>                 m_next {0};
+        size_t                              m_queued = 0;
+        size_t                              m_pending = 0;
+        bool                                m_stop = false;
+    };
+}
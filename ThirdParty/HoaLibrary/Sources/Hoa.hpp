@@ -0,0 +1,42 @@
+// LOCAL STUB - not part of the repo
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <string>
+#define HOA_PI 3.14159265358979323846
+#define HOA_2PI 6.283185307179586476925286766559
+namespace hoa {
+enum Dimension { Hoa2d = 0, Hoa3d = 1 };
+template<Dimension D, typename T> class ProcessorHarmonics {
+public:
+  ProcessorHarmonics(size_t order) : m_order(order) {}
+  virtual ~ProcessorHarmonics() = default;
+  size_t getDecompositionOrder() const noexcept { return m_order; }
+  size_t getNumberOfHarmonics() const noexcept { return D == Hoa2d ? 2*m_order+1 : (m_order+1)*(m_order+1); }
+  size_t getHarmonicDegree(size_t i) const noexcept { if(D==Hoa2d) return (i+1)/2; return size_t(std::sqrt(double(i))); }
+  long getHarmonicOrder(size_t i) const noexcept { if(D==Hoa2d) return (i%2) ? -long((i+1)/2) : long(i/2); long l = long(getHarmonicDegree(i)); return long(i) - l*(l+1); }
+  size_t getHarmonicIndex(size_t l, long m) const noexcept { if(D==Hoa2d) return size_t(std::abs(m))*2 - (m<0); return size_t(long(l*(l+1))+m); }
+private: size_t m_order;
+};
+template<Dimension D, typename T> class Encoder : public ProcessorHarmonics<D,T> {
+public:
+  Encoder(size_t order) : ProcessorHarmonics<D,T>(order) {}
+  void setAzimuth(T a) { m_az = a; } void setElevation(T e) { m_el = e; }
+  static double fact(long n) { double r = 1; for(long i = 2; i <= n; ++i) r *= i; return r; }
+  void process(const T* in, T* out) {
+    const size_t N = this->getDecompositionOrder();
+    if(D == Hoa2d) { out[0] = in[0]; for(size_t l = 1; l <= N; ++l) { out[2*l-1] = in[0]*std::sin(l*m_az); out[2*l] = in[0]*std::cos(l*m_az);} return; }
+    for(size_t i = 0; i < this->getNumberOfHarmonics(); ++i) {
+      long l = long(this->getHarmonicDegree(i)); long m = this->getHarmonicOrder(i); long am = std::abs(m);
+      double n = std::sqrt((am ? 2. : 1.) * fact(l-am)/fact(l+am));
+      double p = std::assoc_legendre(unsigned(l), unsigned(am), std::sin(m_el));
+      double t = m < 0 ? std::sin(am*m_az) : std::cos(am*m_az);
+      out[i] = in[0] * n * p * t;
+    }
+  }
+private: T m_az = 0, m_el = 0;
+};
+template<typename T> struct Signal { static void add(size_t n, const T* in, T* out) { for(size_t i=0;i<n;++i) out[i]+=in[i]; } };
+}
@@ -0,0 +1,37 @@
+// LOCAL STUB - not part of the repo (in-memory files for testing)
+#pragma once
+#include <cstdint>
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+typedef int64_t sf_count_t;
+#define SFM_READ 0x10
+#define SFM_WRITE 0x20
+#define SF_FORMAT_WAV 0x010000
+#define SF_FORMAT_PCM_16 0x0002
+#define SF_FORMAT_PCM_24 0x0003
+#define SF_FORMAT_FLOAT 0x0006
+#define SF_FORMAT_PCM_32 0x0004
+#define SF_FORMAT_SUBMASK 0x0000FFFF
+struct StubFile { int channels = 0; int samplerate = 0; std::vector<double> data; };
+inline std::map<std::string, std::shared_ptr<StubFile>>& stubFiles() { static std::map<std::string, std::shared_ptr<StubFile>> f; return f; }
+inline std::mutex& stubMutex() { static std::mutex m; return m; }
+class SndfileHandle {
+public:
+  SndfileHandle() = default;
+  SndfileHandle(const std::string& p, int mode = SFM_READ, int = 0, int ch = 0, int sr = 0) {
+    std::lock_guard<std::mutex> l(stubMutex());
+    if(mode == SFM_WRITE) { f = std::make_shared<StubFile>(); f->channels = ch; f->samplerate = sr; stubFiles()[p] = f; }
+    else { auto it = stubFiles().find(p); if(it != stubFiles().end()) f = it->second; }
+  }
+  explicit operator bool() const { return bool(f); }
+  int channels() const { return f ? f->channels : 0; } sf_count_t frames() const { return f ? sf_count_t(f->data.size() / f->channels) : 0; } int samplerate() const { return f ? f->samplerate : 0; } int format() const { return 0; }
+  template<class T> sf_count_t read(T* o, sf_count_t n) { sf_count_t c = 0; while(c < n && pos < f->data.size()) o[c++] = T(f->data[pos++]); return c; }
+  template<class T> sf_count_t readf(T* o, sf_count_t n) { return read(o, n * f->channels) / f->channels; }
+  template<class T> sf_count_t writef(const T* o, sf_count_t n) { for(sf_count_t i = 0; i < n * f->channels; ++i) f->data.push_back(double(o[i])); return n; }
+  template<class T> sf_count_t write(const T* o, sf_count_t n) { for(sf_count_t i = 0; i < n; ++i) f->data.push_back(double(o[i])); return n; }
+  const char* strError() const { return ""; }
+private: std::shared_ptr<StubFile> f; size_t pos = 0;
+};